@@ -19,6 +19,8 @@ typedef struct {
         sg_image pal_img;   // optional color palette texture
         sg_sampler smp;
         gfx_dim_t dim;
+        size_t bytes_per_pixel; // 1 if paletted, 4 for RGBA8
+        bool uploaded;      // img holds the framebuffer content
     } fb;
     struct {
         gfx_rect_t view;
@@ -27,6 +29,7 @@ typedef struct {
         sg_sampler smp;
         sg_buffer vbuf;
         sg_pipeline pip;
+        sg_pipeline rgba_pip;   // for the framebuffers without palette
         sg_attachments attachments;
         sg_pass_action pass_action;
     } offscreen;
@@ -123,9 +126,10 @@ static void gfx_init_images_and_pass(void) {
     state.fb.img = sg_make_image(&(sg_image_desc){
         .width = state.fb.dim.width,
         .height = state.fb.dim.height,
-        .pixel_format = SG_PIXELFORMAT_R8,
+        .pixel_format = (state.fb.bytes_per_pixel == 4) ? SG_PIXELFORMAT_RGBA8 : SG_PIXELFORMAT_R8,
         .usage = SG_USAGE_STREAM,
     });
+    state.fb.uploaded = false;
 
     // a sampler for sampling the emulators raw pixel data
     state.fb.smp = sg_make_sampler(&(sg_sampler_desc){
@@ -206,6 +210,7 @@ void gfx_init(const gfx_desc_t* desc) {
     state.display.portrait = desc->display_info.portrait;
     state.draw_extra_cb = desc->draw_extra_cb;
     state.fb.dim = desc->display_info.frame.dim;
+    state.fb.bytes_per_pixel = GFX_DEF(desc->display_info.frame.bytes_per_pixel, 1);
     state.offscreen.pixel_aspect.width = GFX_DEF(desc->pixel_aspect.width, 1);
     state.offscreen.pixel_aspect.height = GFX_DEF(desc->pixel_aspect.height, 1);
     state.offscreen.view = desc->display_info.screen;
@@ -239,6 +244,18 @@ void gfx_init(const gfx_desc_t* desc) {
         .primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP,
         .depth.pixel_format = SG_PIXELFORMAT_NONE
     });
+    sg_shader rgba_shd = sg_make_shader(offscreen_shader_desc(sg_query_backend()));
+    state.offscreen.rgba_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = rgba_shd,
+        .layout = {
+            .attrs = {
+                [0].format = SG_VERTEXFORMAT_FLOAT2,
+                [1].format = SG_VERTEXFORMAT_FLOAT2
+            }
+        },
+        .primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP,
+        .depth.pixel_format = SG_PIXELFORMAT_NONE
+    });
 
     state.display.pass_action = (sg_pass_action) {
         .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.05f, 0.05f, 0.05f, 1.0f } }
@@ -315,41 +332,57 @@ void gfx_draw(gfx_display_info_t display_info) {
 
     state.offscreen.view = display_info.screen;
 
-    // check if emulator framebuffer size has changed, need to create new backing texture
-    if ((display_info.frame.dim.width != state.fb.dim.width) || (display_info.frame.dim.height != state.fb.dim.height)) {
+    // check if emulator framebuffer size or format has changed, need to create new backing texture
+    const size_t bytes_per_pixel = GFX_DEF(display_info.frame.bytes_per_pixel, 1);
+    if ((display_info.frame.dim.width != state.fb.dim.width) || (display_info.frame.dim.height != state.fb.dim.height) || (bytes_per_pixel != state.fb.bytes_per_pixel)) {
         state.fb.dim = display_info.frame.dim;
+        state.fb.bytes_per_pixel = bytes_per_pixel;
         gfx_init_images_and_pass();
     }
 
-    // copy emulator pixel data into emulator framebuffer texture
-    sg_update_image(state.fb.img, &(sg_image_data){
-        .subimage[0][0] = {
-            .ptr = display_info.frame.buffer.ptr,
-            .size = display_info.frame.buffer.size,
-        }
-    });
+    // copy emulator pixel data into emulator framebuffer texture, unless no row changed
+    if (!state.fb.uploaded || !display_info.dirty.valid || (display_info.dirty.height > 0)) {
+        sg_update_image(state.fb.img, &(sg_image_data){
+            .subimage[0][0] = {
+                .ptr = display_info.frame.buffer.ptr,
+                .size = display_info.frame.buffer.size,
+            }
+        });
+        state.fb.uploaded = true;
+    }
 
-    sg_update_image(state.fb.pal_img, &(sg_image_data){
-        .subimage[0][0] = {
-            .ptr = display_info.palette.ptr,
-            .size = display_info.palette.size,
-        }
-    });
+    if (display_info.palette.ptr) {
+        sg_update_image(state.fb.pal_img, &(sg_image_data){
+            .subimage[0][0] = {
+                .ptr = display_info.palette.ptr,
+                .size = display_info.palette.size,
+            }
+        });
+    }
 
     // upscale the original framebuffer 2x with nearest filtering
     sg_begin_pass(&(sg_pass){
         .action = state.offscreen.pass_action,
         .attachments = state.offscreen.attachments
     });
-    sg_apply_pipeline(state.offscreen.pip);
-    sg_apply_bindings(&(sg_bindings){
-        .vertex_buffers[0] = state.offscreen.vbuf,
-        .images = {
-            [IMG_fb_tex] = state.fb.img,
-            [IMG_pal_tex] = state.fb.pal_img,
-        },
-        .samplers[SMP_smp] = state.fb.smp,
-    });
+    if (display_info.palette.ptr) {
+        sg_apply_pipeline(state.offscreen.pip);
+        sg_apply_bindings(&(sg_bindings){
+            .vertex_buffers[0] = state.offscreen.vbuf,
+            .images = {
+                [IMG_fb_tex] = state.fb.img,
+                [IMG_pal_tex] = state.fb.pal_img,
+            },
+            .samplers[SMP_smp] = state.fb.smp,
+        });
+    } else {
+        sg_apply_pipeline(state.offscreen.rgba_pip);
+        sg_apply_bindings(&(sg_bindings){
+            .vertex_buffers[0] = state.offscreen.vbuf,
+            .images[IMG_fb_tex] = state.fb.img,
+            .samplers[SMP_smp] = state.fb.smp,
+        });
+    }
     const offscreen_vs_params_t vs_params = {
         .uv_offset = {
             (float)state.offscreen.view.x / (float)state.fb.dim.width,
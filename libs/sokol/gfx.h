@@ -41,6 +41,11 @@ typedef struct {
     gfx_rect_t screen;
     gfx_range_t palette;
     bool portrait;
+    // optional rows of the framebuffer changed since the last frame, all rows are assumed to change when not valid
+    struct {
+        bool valid;
+        int y, height;
+    } dirty;
 } gfx_display_info_t;
 
 typedef struct {
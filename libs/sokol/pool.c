@@ -0,0 +1,198 @@
+#include "pool.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    #define POOL_NO_THREADS (1)
+#elif defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+#define POOL_MAX_THREADS (16)
+
+typedef struct {
+    bool valid;
+    int num_threads;
+    // shared with the pool threads, guarded by the lock
+    pool_func_t func;
+    void* user_data;
+    int num;                // number of tasks of the current run
+    int next;               // index of the next task to start
+    int pending;            // tasks not finished yet
+    bool quit;
+    #if defined(POOL_NO_THREADS)
+    #elif defined(_WIN32)
+        HANDLE threads[POOL_MAX_THREADS];
+        SRWLOCK lock;
+        CONDITION_VARIABLE work_cond;
+        CONDITION_VARIABLE done_cond;
+    #else
+        pthread_t threads[POOL_MAX_THREADS];
+        pthread_mutex_t lock;
+        pthread_cond_t work_cond;
+        pthread_cond_t done_cond;
+    #endif
+} pool_state_t;
+static pool_state_t state;
+
+#if defined(POOL_NO_THREADS)
+#elif defined(_WIN32)
+static void pool_lock(void) { AcquireSRWLockExclusive(&state.lock); }
+static void pool_unlock(void) { ReleaseSRWLockExclusive(&state.lock); }
+static void pool_wait_work(void) { SleepConditionVariableSRW(&state.work_cond, &state.lock, INFINITE, 0); }
+static void pool_wait_done(void) { SleepConditionVariableSRW(&state.done_cond, &state.lock, INFINITE, 0); }
+static void pool_signal_work(void) { WakeAllConditionVariable(&state.work_cond); }
+static void pool_signal_done(void) { WakeAllConditionVariable(&state.done_cond); }
+#else
+static void pool_lock(void) { pthread_mutex_lock(&state.lock); }
+static void pool_unlock(void) { pthread_mutex_unlock(&state.lock); }
+static void pool_wait_work(void) { pthread_cond_wait(&state.work_cond, &state.lock); }
+static void pool_wait_done(void) { pthread_cond_wait(&state.done_cond, &state.lock); }
+static void pool_signal_work(void) { pthread_cond_broadcast(&state.work_cond); }
+static void pool_signal_done(void) { pthread_cond_broadcast(&state.done_cond); }
+#endif
+
+#if !defined(POOL_NO_THREADS)
+// runs the remaining tasks of the current run, called with the lock held
+static void pool_run_tasks(void) {
+    while (state.next < state.num) {
+        const int index = state.next++;
+        pool_func_t func = state.func;
+        void* user_data = state.user_data;
+        pool_unlock();
+        func(index, user_data);
+        pool_lock();
+        if (--state.pending == 0) {
+            pool_signal_done();
+        }
+    }
+}
+
+static void pool_loop(void) {
+    pool_lock();
+    while (true) {
+        while ((state.next >= state.num) && !state.quit) {
+            pool_wait_work();
+        }
+        if (state.quit) {
+            break;
+        }
+        pool_run_tasks();
+    }
+    pool_unlock();
+}
+#endif
+
+#if defined(POOL_NO_THREADS)
+#elif defined(_WIN32)
+static DWORD WINAPI pool_thread(LPVOID arg) {
+    (void)arg;
+    pool_loop();
+    return 0;
+}
+#else
+static void* pool_thread(void* arg) {
+    (void)arg;
+    pool_loop();
+    return 0;
+}
+#endif
+
+#if !defined(POOL_NO_THREADS)
+static int pool_num_cores(void) {
+    #if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return (int)info.dwNumberOfProcessors;
+    #else
+        const long n = sysconf(_SC_NPROCESSORS_ONLN);
+        return (n > 0) ? (int)n : 1;
+    #endif
+}
+#endif
+
+void pool_init(int num_threads) {
+    state = (pool_state_t){ .valid = true };
+    #if defined(POOL_NO_THREADS)
+        (void)num_threads;
+        state.num_threads = 1;
+    #else
+        if (num_threads <= 0) {
+            num_threads = pool_num_cores();
+        }
+        state.num_threads = (num_threads > POOL_MAX_THREADS) ? POOL_MAX_THREADS : num_threads;
+        #if defined(_WIN32)
+            InitializeSRWLock(&state.lock);
+            InitializeConditionVariable(&state.work_cond);
+            InitializeConditionVariable(&state.done_cond);
+            for (int i = 0; i < state.num_threads - 1; i++) {
+                state.threads[i] = CreateThread(NULL, 0, pool_thread, NULL, 0, NULL);
+                assert(state.threads[i]);
+            }
+        #else
+            pthread_mutex_init(&state.lock, 0);
+            pthread_cond_init(&state.work_cond, 0);
+            pthread_cond_init(&state.done_cond, 0);
+            for (int i = 0; i < state.num_threads - 1; i++) {
+                int res = pthread_create(&state.threads[i], 0, pool_thread, 0);
+                assert(res == 0); (void)res;
+            }
+        #endif
+    #endif
+}
+
+void pool_shutdown(void) {
+    assert(state.valid);
+    #if !defined(POOL_NO_THREADS)
+        pool_lock();
+        state.quit = true;
+        pool_signal_work();
+        pool_unlock();
+    #endif
+    #if defined(_WIN32)
+        for (int i = 0; i < state.num_threads - 1; i++) {
+            WaitForSingleObject(state.threads[i], INFINITE);
+            CloseHandle(state.threads[i]);
+        }
+    #elif !defined(POOL_NO_THREADS)
+        for (int i = 0; i < state.num_threads - 1; i++) {
+            pthread_join(state.threads[i], 0);
+        }
+        pthread_cond_destroy(&state.done_cond);
+        pthread_cond_destroy(&state.work_cond);
+        pthread_mutex_destroy(&state.lock);
+    #endif
+    state.valid = false;
+}
+
+int pool_num_threads(void) {
+    assert(state.valid);
+    return state.num_threads;
+}
+
+void pool_run(int num, pool_func_t func, void* user_data) {
+    assert(state.valid && func);
+    #if defined(POOL_NO_THREADS)
+        for (int i = 0; i < num; i++) {
+            func(i, user_data);
+        }
+    #else
+        pool_lock();
+        assert(state.pending == 0);
+        state.func = func;
+        state.user_data = user_data;
+        state.num = num;
+        state.next = 0;
+        state.pending = num;
+        pool_signal_work();
+        // the calling thread takes its share of the tasks
+        pool_run_tasks();
+        while (state.pending > 0) {
+            pool_wait_done();
+        }
+        pool_unlock();
+    #endif
+}
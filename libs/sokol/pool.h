@@ -0,0 +1,20 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// a task function, called once for each index passed to pool_run()
+typedef void (*pool_func_t)(int index, void* user_data);
+
+// starts num_threads-1 threads, the thread calling pool_run() is the last one, 0 uses one thread per core
+void pool_init(int num_threads);
+void pool_shutdown(void);
+// number of threads running the tasks, including the calling thread
+int pool_num_threads(void);
+// calls func for the indices 0 to num-1 on the pool threads and returns when all calls are done
+void pool_run(int num, pool_func_t func, void* user_data);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
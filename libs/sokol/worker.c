@@ -0,0 +1,182 @@
+#include "worker.h"
+#include <assert.h>
+#include <stddef.h>
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    #define WORKER_NO_THREADS (1)
+#elif defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+typedef struct {
+    bool valid;
+    bool busy;              // a job was started and not yet reported, frame thread only
+    worker_func_t func;
+    worker_func_t done;
+    void* user_data;
+    // shared with the worker thread, guarded by the lock
+    bool posted;
+    bool finished;
+    bool quit;
+    #if defined(WORKER_NO_THREADS)
+    #elif defined(_WIN32)
+        HANDLE thread;
+        SRWLOCK lock;
+        CONDITION_VARIABLE cond;
+    #else
+        pthread_t thread;
+        pthread_mutex_t lock;
+        pthread_cond_t cond;
+    #endif
+} worker_state_t;
+static worker_state_t state;
+
+#if defined(WORKER_NO_THREADS)
+static void worker_lock(void) { }
+static void worker_unlock(void) { }
+static void worker_wait_cond(void) { }
+static void worker_signal(void) { }
+#elif defined(_WIN32)
+static void worker_lock(void) { AcquireSRWLockExclusive(&state.lock); }
+static void worker_unlock(void) { ReleaseSRWLockExclusive(&state.lock); }
+static void worker_wait_cond(void) { SleepConditionVariableSRW(&state.cond, &state.lock, INFINITE, 0); }
+static void worker_signal(void) { WakeAllConditionVariable(&state.cond); }
+#else
+static void worker_lock(void) { pthread_mutex_lock(&state.lock); }
+static void worker_unlock(void) { pthread_mutex_unlock(&state.lock); }
+static void worker_wait_cond(void) { pthread_cond_wait(&state.cond, &state.lock); }
+static void worker_signal(void) { pthread_cond_broadcast(&state.cond); }
+#endif
+
+#if !defined(WORKER_NO_THREADS)
+static void worker_loop(void) {
+    worker_lock();
+    while (true) {
+        while (!state.posted && !state.quit) {
+            worker_wait_cond();
+        }
+        // a posted job still runs when quitting
+        if (!state.posted) {
+            break;
+        }
+        state.posted = false;
+        worker_func_t func = state.func;
+        void* user_data = state.user_data;
+        worker_unlock();
+        func(user_data);
+        worker_lock();
+        state.finished = true;
+        worker_signal();
+    }
+    worker_unlock();
+}
+#endif
+
+#if defined(WORKER_NO_THREADS)
+#elif defined(_WIN32)
+static DWORD WINAPI worker_thread(LPVOID arg) {
+    (void)arg;
+    worker_loop();
+    return 0;
+}
+#else
+static void* worker_thread(void* arg) {
+    (void)arg;
+    worker_loop();
+    return 0;
+}
+#endif
+
+void worker_init(void) {
+    state = (worker_state_t){ .valid = true };
+    #if defined(WORKER_NO_THREADS)
+    #elif defined(_WIN32)
+        InitializeSRWLock(&state.lock);
+        InitializeConditionVariable(&state.cond);
+        state.thread = CreateThread(NULL, 0, worker_thread, NULL, 0, NULL);
+        assert(state.thread);
+    #else
+        pthread_mutex_init(&state.lock, 0);
+        pthread_cond_init(&state.cond, 0);
+        int res = pthread_create(&state.thread, 0, worker_thread, 0);
+        assert(res == 0); (void)res;
+    #endif
+}
+
+void worker_shutdown(void) {
+    assert(state.valid);
+    worker_wait();
+    worker_lock();
+    state.quit = true;
+    worker_signal();
+    worker_unlock();
+    #if defined(WORKER_NO_THREADS)
+    #elif defined(_WIN32)
+        WaitForSingleObject(state.thread, INFINITE);
+        CloseHandle(state.thread);
+    #else
+        pthread_join(state.thread, 0);
+        pthread_cond_destroy(&state.cond);
+        pthread_mutex_destroy(&state.lock);
+    #endif
+    state.valid = false;
+}
+
+bool worker_start(worker_func_t func, worker_func_t done, void* user_data) {
+    assert(state.valid && func);
+    if (state.busy) {
+        return false;
+    }
+    state.busy = true;
+    state.func = func;
+    state.done = done;
+    state.user_data = user_data;
+    #if defined(WORKER_NO_THREADS)
+        func(user_data);
+        state.finished = true;
+    #else
+        worker_lock();
+        state.posted = true;
+        worker_signal();
+        worker_unlock();
+    #endif
+    return true;
+}
+
+bool worker_busy(void) {
+    assert(state.valid);
+    return state.busy;
+}
+
+static void worker_report(void) {
+    state.busy = false;
+    if (state.done) {
+        state.done(state.user_data);
+    }
+}
+
+void worker_dowork(void) {
+    assert(state.valid);
+    worker_lock();
+    const bool finished = state.finished;
+    state.finished = false;
+    worker_unlock();
+    if (finished) {
+        worker_report();
+    }
+}
+
+void worker_wait(void) {
+    assert(state.valid);
+    if (!state.busy) {
+        return;
+    }
+    worker_lock();
+    while (!state.finished) {
+        worker_wait_cond();
+    }
+    state.finished = false;
+    worker_unlock();
+    worker_report();
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// a job function, called with the user data passed to worker_start()
+typedef void (*worker_func_t)(void* user_data);
+
+void worker_init(void);
+// waits for the running job and reports it before stopping the worker thread
+void worker_shutdown(void);
+// run func on the worker thread (directly on platforms without threads), returns false while busy,
+// with emscripten func can't use the APIs of the main thread (IndexedDB...), done runs on it
+
+bool worker_start(worker_func_t func, worker_func_t done, void* user_data);
+bool worker_busy(void);
+// call once per frame, invokes the done callback of a finished job on the calling thread
+void worker_dowork(void);
+// blocks until the running job has finished and reports it like worker_dowork()
+void worker_wait(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
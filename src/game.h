@@ -85,6 +85,9 @@ extern "C" {
 #define GAME_SFX_NUM_CHANNELS           (4)
 #define GAME_MAX_AUDIO_SAMPLES          (2048*16)    // max number of audio samples in internal sample buffer
 
+#define GAME_MAX_SCALE                  (6)          // largest game_desc_t.scale
+#define GAME_REWIND_MAX_FRAMES          (30000)      // VM frames kept by the rewind history at most
+
 #define GAME_DBG_SCRIPT                 (1 << 0)
 #define GAME_DBG_BANK                   (1 << 1)
 #define GAME_DBG_VIDEO                  (1 << 2)
@@ -105,8 +108,18 @@ extern "C" {
 
 #define GAME_QUAD_STRIP_MAX_VERTICES    (70)
 
-// bump when game_t memory layout changes
-#define GAME_SNAPSHOT_VERSION           (0x0001)
+// bump when game_t memory layout or the snapshot stream format changes
+#define GAME_SNAPSHOT_VERSION           (0x0014)
+
+#define GAME_CACHE_LINE_SIZE            (64)
+
+#if defined(__cplusplus)
+    #define GAME_ALIGNAS(n) alignas(n)
+#elif defined(_MSC_VER)
+    #define GAME_ALIGNAS(n) __declspec(align(n))
+#else
+    #define GAME_ALIGNAS(n) _Alignas(n)
+#endif
 
 typedef struct game_allocator {
     void* (*alloc_fn)(size_t size, void* user_data);
@@ -153,8 +166,11 @@ typedef enum {
     DIR_DOWN  = 1 << 3
 } game_input_dir_t;
 
+// all the data references below are offsets in res.mem, resources are never
+// loaded at offset 0 (a part segment is always there) so 0 means none
+
 typedef struct {
-    uint8_t *data;
+    uint32_t data;
     uint16_t volume;
 } game_audio_sfx_instrument_t;
 
@@ -162,7 +178,7 @@ typedef struct {
     uint16_t    note_1;
     uint16_t    note_2;
     uint16_t    sample_start;
-    uint8_t*    sample_buffer;
+    uint32_t    sample_buffer;
     uint16_t    sample_len;
     uint16_t    loop_pos;
     uint16_t    loop_len;
@@ -170,11 +186,11 @@ typedef struct {
 } game_audio_sfx_pattern_t;
 
 typedef struct {
-    const uint8_t*              data;
+    uint32_t                    data;
     uint16_t                    cur_pos;
     uint8_t                     cur_order;
     uint8_t                     num_order;
-    uint8_t*                    order_table;
+    uint32_t                    order_table;
     game_audio_sfx_instrument_t samples[15];
 } game_audio_sfx_module_t;
 
@@ -184,7 +200,7 @@ typedef struct {
 } game_frac_t;
 
 typedef struct  {
-    uint8_t*    sample_data;
+    uint32_t    sample_data;
     uint16_t    sample_len;
     uint16_t    sample_loop_pos;
     uint16_t    sample_loop_len;
@@ -229,6 +245,76 @@ typedef struct {
     bool* stopped;
 } game_debug_t;
 
+typedef struct {
+    uint32_t max_bytes;     // size of the rewind history, 0 disables rewinding
+} game_rewind_desc_t;
+
+typedef void (*game_band_func_t)(int band, void* band_data);
+// calls func for the bands 0 to num_bands-1 and returns when all calls are done, the calls may run in parallel
+typedef void (*game_parallel_for_t)(int num_bands, game_band_func_t func, void* band_data, void* user_data);
+
+typedef struct {
+    game_parallel_for_t func;       // optional, rasterizes the pages in horizontal bands (enables the display list)
+    void*               user_data;
+    int                 num_bands;  // usually the number of threads
+} game_raster_desc_t;
+
+// pixel formats of game_convert_pixels()
+typedef enum {
+    GAME_PIXEL_RGBA32,      // 0xAABBGGRR like game_t.gfx.palette
+    GAME_PIXEL_RGB565,
+    GAME_PIXEL_RGB555,
+} game_pixel_format_t;
+
+/*
+    Scene stream, see game_desc_t.scene: what is drawn into the pages up to a
+    presented frame, as records of one game_scene_op_t byte followed by the
+    fields below, little endian, in the 320x200 coordinates of the pages. The
+    polygons are given after zoom, the ones entirely outside the page are left
+    out, the others are clipped by the page bounds when drawn.
+
+    GAME_SCENE_OP_BEGIN      u16 GAME_SCENE_VERSION, u32 frame number, first record of a frame
+    GAME_SCENE_OP_FILL       u8 page, u8 color
+    GAME_SCENE_OP_COPY       u8 dst, u8 src, i16 vscroll: row y of src goes to row y+vscroll of dst, the other rows of dst are kept
+    GAME_SCENE_OP_POLYGON    u8 page, u8 game_scene_blend_t, u8 color, u8 n, n x (i16 x, i16 y) outline
+    GAME_SCENE_OP_POINT      u8 page, u8 game_scene_blend_t, u8 color, i16 x, i16 y
+    GAME_SCENE_OP_CHAR       u8 page, u8 color, i16 x, i16 y, 8 x u8 rows of the glyph, bit 7 is the left pixel
+    GAME_SCENE_OP_BITMAP     u8 page, 32000 x u8 pixels, high nibble is the left pixel
+    GAME_SCENE_OP_FRAME      u8 page, 16 x u32 palette 0xAABBGGRR, the page is presented, last record of a frame
+    GAME_SCENE_OP_BACKGROUND u8 page, u16 RT_BITMAP resource, i16 dy, u16 w, u16 h, w*h x u32 pixels 0xAABBGGRR: the
+                             image shows through the pixels of color 0 of the page, stretched to the page and scrolled
+                             down by dy rows, black where scrolled out; a COPY takes it to dst with dy+vscroll, a FILL
+                             or a BITMAP of the page drops it
+*/
+#define GAME_SCENE_VERSION  (2)
+
+typedef enum {
+    GAME_SCENE_OP_BEGIN,
+    GAME_SCENE_OP_FILL,
+    GAME_SCENE_OP_COPY,
+    GAME_SCENE_OP_POLYGON,
+    GAME_SCENE_OP_POINT,
+    GAME_SCENE_OP_CHAR,
+    GAME_SCENE_OP_BITMAP,
+    GAME_SCENE_OP_FRAME,
+    GAME_SCENE_OP_BACKGROUND,
+} game_scene_op_t;
+
+typedef enum {
+    GAME_SCENE_BLEND_SOLID,     // the pixels take the color
+    GAME_SCENE_BLEND_ALPHA,     // the pixels are OR'ed with 8, color is unused
+    GAME_SCENE_BLEND_PAGE,      // the pixels of page 0 are copied, color is unused
+} game_scene_blend_t;
+
+typedef void (*game_scene_func_t)(const uint8_t* data, size_t size, void* user_data);
+
+typedef struct {
+    game_scene_func_t   func;       // optional, called with the scene stream of each presented frame
+    void*               user_data;
+    bool                no_raster;  // only record the polygons and the text, they are not drawn into the pages,
+                                    // which then can't be saved: no snapshots and no rewinding
+} game_scene_desc_t;
+
 // configuration parameters for game_init()
 typedef struct {
     int                 part_num;               // indicates the part number where the fame starts
@@ -238,6 +324,16 @@ typedef struct {
     game_audio_desc_t   audio;
     game_debug_t        debug;
     game_data_t         data;
+    game_rewind_desc_t  rewind;
+    uint32_t            bitmap_cache_bytes;     // size of the cache of decoded bitmaps kept for screen revisits, 0 disables it
+    bool                use_display_list;       // record the draw commands of each page and rasterize them when the page is read
+    bool                fix_up_palette;         // replay the draws pending on the pages when the palette changes, ignore palettes 10 and 16 of the intro (enables the display list)
+    bool                front_to_back;          // rasterize the solid color polygons of the display list front to back, each pixel written once (enables the display list)
+    bool                heatmap;                // count the pixel writes into the pages, see game_heatmap_stats()
+    bool                packed_pages;           // store the pages with 4 bits per pixel, see game_read_page() (ignored with scale)
+    int                 scale;                  // 2 to GAME_MAX_SCALE to also rasterize the pages at a multiple of the resolution, 0 or 1 to disable
+    game_raster_desc_t  raster;
+    game_scene_desc_t   scene;
     game_allocator      allocator;              // optional memory allocation overrides (default: malloc/free)
 } game_desc_t;
 
@@ -245,10 +341,80 @@ typedef struct {
     uint8_t buffer[GAME_WIDTH*GAME_HEIGHT];
 } game_framebuffer_t;
 
+#define GAME_GFX_MAX_CMDS   (2048)      // draw commands recorded per page before it is rasterized
+#define GAME_GFX_MAX_DATA   (0x8000)    // bytes of polygon data recorded per page before it is rasterized
+
+typedef enum {
+    GAME_GFX_CMD_FILL,      // fill the page with color
+    GAME_GFX_CMD_POLYGON,   // polygon data at data, centered on x,y and scaled by zoom
+    GAME_GFX_CMD_CHAR,      // font character data drawn at x,y
+} game_gfx_cmd_type_t;
+
+typedef struct {
+    uint8_t     type;           // game_gfx_cmd_type_t
+    uint8_t     color;
+    uint16_t    zoom;
+    int16_t     x, y;
+    uint16_t    data;           // offset of the polygon data in game_gfx_list_t.data, or the character
+    int16_t     top, bottom;    // rows reached by the command, to skip it in the other bands
+} game_gfx_cmd_t;
+
+// draw commands of a page which are not rasterized yet
+typedef struct {
+    uint16_t        num_cmds;
+    uint16_t        data_size;
+    bool            reads_page0;    // a command copies pixels from page 0
+    game_gfx_cmd_t  cmds[GAME_GFX_MAX_CMDS];
+    uint8_t         data[GAME_GFX_MAX_DATA];
+} game_gfx_list_t;
+
+#define GAME_SHAPE_CACHE_SHAPES     (512)       // compiled shapes, a power of two
+#define GAME_SHAPE_CACHE_POLYGONS   (8192)      // polygons of all the compiled shapes
+#define GAME_SHAPE_CACHE_VERTICES   (32768)     // vertices of all the compiled polygons
+
+// a polygon scaled by the zoom of its shape, the position is relative to the one the shape is drawn at
+typedef struct {
+    uint32_t    data;           // offset of the polygon data in res.mem
+    int16_t     x, y;
+    uint16_t    bbw, bbh;       // scaled bounding box
+    uint16_t    rows;           // rows covered by the edges of one side
+    uint16_t    vertices;       // index of the first vertex in game_shape_cache_t
+    uint8_t     num_vertices;
+    uint8_t     color;
+} game_shape_polygon_t;
+
+// a shape tree of the video segments flattened into its polygons, for one zoom
+typedef struct {
+    bool        used;
+    uint16_t    zoom;
+    uint32_t    offset;         // offset of the shape data in res.mem
+    uint32_t    data_buf;       // video segment the offsets of the children refer to
+    uint32_t    end;            // video.p_data.pc after walking the tree
+    uint16_t    polygons;       // index of the first polygon
+    uint16_t    num_polygons;
+    int32_t     x0, y0, x1, y1; // union of the scaled bounding boxes of the polygons
+} game_shape_t;
+
+// shapes compiled on their first draw, emptied when a part is loaded or the cache is full,
+// allocated on the first shape drawn
+typedef struct {
+    int                     num_shapes;
+    int                     num_polygons;
+    int                     num_vertices;
+    game_shape_t            shapes[GAME_SHAPE_CACHE_SHAPES];
+    game_shape_polygon_t    polygons[GAME_SHAPE_CACHE_POLYGONS];
+    // vertices relative to the corner of the bounding box, and the same at the high resolution
+    // scale, allocated after the cache with host.hires only
+    int16_t                 vx[GAME_SHAPE_CACHE_VERTICES];
+    int16_t                 vy[GAME_SHAPE_CACHE_VERTICES];
+    int32_t*                hx;
+    int32_t*                hy;
+} game_shape_cache_t;
+
 typedef struct {
     uint8_t     status;         // 0x0
     uint8_t     type;           // 0x1, Resource::ResType
-    uint8_t*    buf_ptr;        // 0x2
+    uint32_t    buf_pos;        // 0x2, offset in res.mem
     uint8_t     rank_num;       // 0x6
     uint8_t     bank_num;       // 0x7
     uint32_t    bank_pos;       // 0x8
@@ -257,11 +423,11 @@ typedef struct {
 } game_mem_entry_t;
 
 typedef struct {
-    uint8_t *pc;
+    uint32_t pc;                // offset in res.mem
 } game_pc_t;
 
 typedef struct {
-    const uint8_t *data;
+    uint32_t      data;         // offset in res.mem, 0 when stopped
     game_frac_t   pos;
     uint32_t      len;
     uint32_t      loop_len, loop_pos;
@@ -273,60 +439,178 @@ typedef struct {
     const char* str;
 } game_str_entry_t;
 
+// range of rows, empty when top > bottom
+typedef struct {
+    int16_t top, bottom;
+} game_gfx_rows_t;
+
+typedef enum {
+    GAME_GFX_PAGE_PIXELS,   // the page buffer holds the pixels
+    GAME_GFX_PAGE_SOLID,    // filled with color, not written yet
+    GAME_GFX_PAGE_ALIAS,    // copy of the page src, not written yet
+} game_gfx_page_state_t;
+
+// what a page holds when its pixels are not written yet
+typedef struct {
+    int8_t  state;          // game_gfx_page_state_t
+    uint8_t color;          // of GAME_GFX_PAGE_SOLID
+    int8_t  src;            // of GAME_GFX_PAGE_ALIAS, a page in the GAME_GFX_PAGE_PIXELS state
+} game_gfx_lazy_t;
+
+// pages rasterized at game_desc_t.scale times the original resolution, the
+// 320x200 pages stay the reference for the VM, the debugger and the snapshot
+// files, only the rewind captures keep these pages too
+typedef struct {
+    int         scale;
+    int         width, height;
+    uint8_t*    fbs[4];         // the 4 pages
+    uint8_t*    fb;             // copy of the displayed page, see gfx.presented
+} game_hires_t;
+
+// pixels already written by the commands in front, one bit per pixel, see game_desc_t.front_to_back
+typedef struct {
+    uint64_t*   rows;                   // GAME_WIDTH / 64 words per row
+    uint64_t*   hires_rows;             // the same for the high resolution pages
+    uint32_t    drawn[GAME_HEIGHT];     // pixels of the 320x200 spans of each row, as drawn back to front
+    uint32_t    written[GAME_HEIGHT];   // pixels of these spans actually written
+} game_gfx_cover_t;
+
+typedef struct {
+    uint64_t    drawn;
+    uint64_t    written;
+} game_gfx_overdraw_t;
+
+typedef enum {
+    GAME_GFX_WRITE_SOLID,       // solid color polygons
+    GAME_GFX_WRITE_ALPHA,       // transparent polygons (|= 8)
+    GAME_GFX_WRITE_PAGE,        // polygons copying page 0
+    GAME_GFX_WRITE_COPY,        // page copies
+    GAME_GFX_WRITE_CLEAR,       // page fills
+    GAME_GFX_WRITE_GLYPH,       // string characters
+    GAME_GFX_WRITE_BITMAP,      // background bitmaps
+    GAME_GFX_WRITE_NUM,
+} game_gfx_write_t;
+
+typedef struct {
+    uint64_t    writes[GAME_GFX_WRITE_NUM];     // pixel writes of each kind into the 4 pages
+    uint32_t    pixels;                         // pixels written at least once
+    float       overdraw;                       // writes per pixel written
+} game_gfx_heat_stats_t;
+
+// pixel writes into the 320x200 pages between two page flips, see game_desc_t.heatmap
+typedef struct {
+    int                     cur;                                        // index of the counts of the frame being drawn
+    uint16_t                counts[2][4][GAME_WIDTH * GAME_HEIGHT];
+    uint32_t                rows[4][GAME_GFX_WRITE_NUM][GAME_HEIGHT];   // writes of each kind per row, a row is only written by one band
+    game_gfx_heat_stats_t   stats;                                      // of the last frame
+} game_gfx_heatmap_t;
+
+#define GAME_GFX_MAX_BACKGROUNDS    (6)     // one more than the 4 pages and the presented frame can refer to
+#define GAME_GFX_NO_BACKGROUND      (0xFFFF)
+
+// a true color image at its own resolution, RGBA like game_t.gfx.palette
+typedef struct {
+    int         width, height;
+    size_t      size;           // pixels allocated
+    uint32_t*   pixels;
+    uint16_t    res_num;        // RT_BITMAP resource decoded into pixels
+} game_gfx_image_t;
+
+// decoded true color backgrounds of the pages (RGB bitmaps), shown through the pixels of color 0,
+// allocated on the first RGB bitmap, the pages refer to them by resource in game_t.gfx.bg_res
+typedef struct {
+    game_gfx_image_t    images[GAME_GFX_MAX_BACKGROUNDS];
+    const uint32_t*     frame;          // presented page over its image, 0 when it has none
+    int                 frame_width, frame_height;
+    uint32_t*           composed;       // the frame when the page isn't all color 0
+    size_t              composed_size;
+    uint8_t*            row;            // page row scaled to the image width
+    uint16_t*           xmap;           // page column of each image column
+    size_t              row_size;
+} game_gfx_background_t;
+
+// large buffers, allocated in game_init() separately from game_t
+typedef struct {
+    uint8_t             mem[GAME_MEM_BLOCK_SIZE];               // resource memory
+    game_framebuffer_t  fbs[4];                                 // the 4 pages
+    uint8_t             fb[GAME_WIDTH*GAME_HEIGHT];             // copy of the displayed page, see gfx.presented
+    int16_t             samples[GAME_MIX_BUF_SIZE];
+    float               sample_buffer[GAME_MAX_AUDIO_SAMPLES];
+} game_buffers_t;
+
+typedef struct {
+    uint32_t    pos;            // offset of the encoded delta in buf
+    uint32_t    size;           // size of the encoded delta
+    uint32_t    stream_size;    // size of the snapshot stream restored by the delta
+    uint32_t    elapsed;        // game_t.elapsed of the frame restored by the delta
+} game_rewind_frame_t;
+
+// rewind history: the snapshot stream of the latest frame and a ring of
+// backward XOR deltas, each one restoring the frame before, the streams
+// keep the draw commands still recorded on the pages and the high resolution pages
+typedef struct {
+    uint8_t*            buf;                // ring buffer of encoded deltas
+    uint32_t            buf_size;
+    uint32_t            head;               // write position in buf
+    uint32_t            first;              // index of the oldest frame
+    uint32_t            num_frames;
+    game_rewind_frame_t frames[GAME_REWIND_MAX_FRAMES];
+    uint8_t*            streams;            // the allocation holding cur and next, which swap after each capture
+    uint32_t            stream_size;        // capacity of cur and next
+    uint8_t*            cur;                // snapshot stream of the latest frame
+    uint32_t            cur_size;
+    uint32_t            cur_elapsed;        // game_t.elapsed of the latest frame
+    uint8_t*            next;               // snapshot stream of the frame being captured
+    uint32_t            next_size;
+} game_rewind_t;
+
+#define GAME_BITMAP_CACHE_MAX   (32)    // bitmaps kept by the bitmap cache whatever its size
+
+// a decoded bitmap, in the page format
+typedef struct {
+    uint16_t    res_num;        // resource of the bitmap
+    uint8_t     data_type;      // game_data_type_t it was decoded from
+    uint32_t    last_use;       // game_bitmap_cache_t.clock at the last use, 0 when the entry is free
+    uint8_t*    pixels;
+} game_bitmap_entry_t;
+
+// decoded bitmaps of the resources, the least recently used one is replaced when all entries are used
+typedef struct {
+    int                 num_entries;    // as many as fit in game_desc_t.bitmap_cache_bytes
+    uint32_t            entry_size;     // bytes of a page
+    uint32_t            clock;
+    game_bitmap_entry_t entries[GAME_BITMAP_CACHE_MAX];
+} game_bitmap_cache_t;
+
+// the scene stream of the frame being drawn, see game_desc_t.scene
+typedef struct {
+    game_scene_desc_t   desc;
+    uint32_t            frame;      // frames presented since game_init()
+    size_t              size;       // bytes recorded for the current frame
+    size_t              capacity;
+    uint8_t*            data;
+} game_scene_t;
+
 typedef struct {
     game_mem_entry_t    mem_list[GAME_ENTRIES_COUNT_20TH];
     uint16_t            num_mem_list;
-    uint8_t             mem[GAME_MEM_BLOCK_SIZE];
+    uint8_t*            mem;            // points to buffers->mem
     uint16_t            current_part, next_part;
-    uint8_t*            script_bak_ptr, *script_cur_ptr, *vid_cur_ptr;
+    uint32_t            script_bak_pos, script_cur_pos, vid_cur_pos;
     bool                use_seg_video2;
-    uint8_t*            seg_video_pal;
-    uint8_t*            seg_code;
+    uint32_t            seg_video_pal;  // the segments are offsets in mem
+    uint32_t            seg_code;
     uint16_t            seg_code_size;
-    uint8_t*            seg_video1;
-    uint8_t*            seg_video2;
+    uint32_t            seg_video1;
+    uint32_t            seg_video2;
     bool                has_password_screen;
     game_data_type_t    data_type;
-    game_data_t         data;
     game_lang_t         lang;
 } game_res_t;
 
 typedef struct {
-    bool                    valid;
-    bool                    enable_protection;
-    game_debug_t            debug;
-    game_res_t              res;
-    const game_str_entry_t* strings_table;
-    int                     part_num;
-    uint32_t                elapsed;
-    uint32_t                sleep;
-
-    struct {
-        uint8_t             fb[GAME_WIDTH*GAME_HEIGHT];    // frame buffer: this where is stored the image with indexed color
-        game_framebuffer_t  fbs[4];
-        uint32_t            palette[16];    // palette containing 16 RGBA colors
-        uint8_t*            draw_page_ptr;
-        bool                fix_up_palette; // redraw all primitives on setPal script call
-    } gfx;
-
-    struct {
-        float                   sample_buffer[GAME_MAX_AUDIO_SAMPLES];
-        int                     num_samples;
-        int16_t                 samples[GAME_MIX_BUF_SIZE];
-        game_audio_channel_t    channels[GAME_MIX_CHANNELS];
-        game_audio_sfx_player_t sfx_player;
-        game_audio_callback_t   callback;
-    } audio;
-
-    struct {
-        uint8_t                 next_pal, current_pal;
-        uint8_t                 buffers[3];
-        game_pc_t               p_data;
-        uint8_t*                data_buf;
-        bool                    use_ega;
-    } video;
-
-    struct {
+    // hot interpreter state first, on its own cache lines
+    GAME_ALIGNAS(GAME_CACHE_LINE_SIZE) struct {
         int16_t     vars[256];
         uint16_t    stack_calls[64];
         struct {
@@ -355,16 +639,80 @@ typedef struct {
         struct {
             uint8_t         keymask;
             uint8_t         counter;
-
-            const uint8_t*  buf_ptr;
-            size_t          buf_pos, buf_size;
+            size_t          buf_pos, buf_size; // position in host.data.demo3_joy
         } demo_joy;
     } input;
 
-    const char*     title;      // title of the game
-    game_allocator  allocator;  // optional memory allocation overrides (default: malloc/free)
+    struct {
+        uint8_t                 next_pal, current_pal;
+        uint8_t                 buffers[3];
+        game_pc_t               p_data;
+        uint32_t                data_buf;   // offset of the current shape segment in res.mem
+        bool                    use_ega;
+        uint32_t                palettes[32][16];   // the palettes of the current part as RGBA, expanded at part setup
+    } video;
+
+    bool                    valid;
+    bool                    enable_protection;
+    game_debug_t            debug;
+    int                     part_num;
+    uint32_t                elapsed;
+    uint32_t                sleep;
+
+    struct {
+        uint8_t*            fb;             // copy of the displayed page, made before that page is drawn into
+        game_framebuffer_t* fbs;            // the 4 pages
+        uint32_t            palette[16];    // palette containing 16 RGBA colors
+        uint8_t             draw_page;      // index of the page drawn to
+        bool                fix_up_palette; // redraw all primitives on setPal script call, see game_desc_t.fix_up_palette
+        game_gfx_lazy_t     lazy[4];        // pages filled or copied but not written yet
+        int8_t              mirror[5];      // page last copied in full into each page and the frame buffer (index 4), -1 if none
+        game_gfx_rows_t     diff[5];        // rows which may differ from that page since the copy
+        game_gfx_rows_t     fb_dirty;       // rows of the frame buffer changed since game_reset_dirty_rows()
+        int8_t              presented;      // page displayed by the host, or 4 when it is the copy in fb
+        uint16_t            bg_res[5];      // RGB bitmap behind each page and the presented frame (index 4), GAME_GFX_NO_BACKGROUND for none
+        int16_t             bg_dy[5];       // rows of the page the bitmap is scrolled down by
+    } gfx;
+
+    struct {
+        float*                  sample_buffer;
+        int                     num_samples;
+        int16_t*                samples;
+        game_audio_channel_t    channels[GAME_MIX_CHANNELS];
+        game_audio_sfx_player_t sfx_player;
+        game_audio_callback_t   callback;
+    } audio;
+
+    game_res_t      res;
+
+    // the data, memory and options of the host, everything above is the game state written by game_save_snapshot()
+    struct {
+        game_data_t             data;
+        const game_str_entry_t* strings_table;
+        const char*             title;          // title of the game
+        game_buffers_t*         buffers;        // large buffers referenced by the game state
+        game_rewind_t*          rewind;         // optional rewind history, see game_rewind()
+        game_bitmap_cache_t*    bitmaps;        // optional, see game_desc_t.bitmap_cache_bytes
+        bool                    use_display_list;
+        game_gfx_list_t*        lists;          // pending draw commands of the 4 pages, allocated with use_display_list
+        game_shape_cache_t*     shapes;         // compiled shapes, see _game_shape_get()
+        game_hires_t*           hires;          // optional high resolution pages, see game_desc_t.scale
+        bool                    front_to_back;
+        game_gfx_cover_t*       cover;
+        game_gfx_overdraw_t     overdraw;       // pixels of the polygons drawn front to back, drawn/written is the overdraw saved
+        game_gfx_heatmap_t*     heatmap;
+        bool                    packed;         // the pages hold 2 pixels per byte, see game_desc_t.packed_pages
+        game_gfx_background_t*  background;     // optional true color layer, see _game_gfx_draw_background()
+        game_scene_t*           scene;          // optional scene stream, see game_desc_t.scene
+        game_raster_desc_t      raster;
+        game_allocator          allocator;      // optional memory allocation overrides (default: malloc/free)
+    } host;
 } game_t;
 
+// upper bound of the number of bytes written by game_save_snapshot()
+#define GAME_SNAPSHOT_MAX_SIZE (20 + offsetof(game_t, host) + GAME_MEM_BLOCK_SIZE + 5 * (1 + GAME_WIDTH * GAME_HEIGHT))
+
+// the frame buffer refers to the displayed page and stays unchanged until the next game_exec()
 gfx_display_info_t game_display_info(game_t* game);
 void game_init(game_t* game, const game_desc_t* desc);
 void game_exec(game_t* game, uint32_t micro_seconds);
@@ -382,9 +730,36 @@ void game_audio_callback_snapshot_onsave(game_audio_callback_t* snapshot);
 void game_audio_callback_snapshot_onload(game_audio_callback_t* snapshot, game_audio_callback_t* sys);
 void game_debug_snapshot_onsave(game_debug_t* snapshot);
 void game_debug_snapshot_onload(game_debug_t* snapshot, game_debug_t* sys);
-bool game_load_snapshot(game_t* game, uint32_t version, game_t* src);
-uint32_t game_save_snapshot(game_t* game, game_t* dst);
+// restore the game state from a stream written by game_save_snapshot(), returns false for invalid data or another version,
+// or with game_desc_t.scene.no_raster
+bool game_load_snapshot(game_t* game, const uint8_t* src, size_t src_size);
+// serialize the live game state into dst, returns the number of bytes written (0 if dst_size is too small or with
+// game_desc_t.scene.no_raster, the pages don't hold what is drawn)
+size_t game_save_snapshot(game_t* game, uint8_t* dst, size_t dst_size);
+// step back up to the given number of VM frames, returns the number of frames rewound
+uint32_t game_rewind(game_t* game, uint32_t frames);
+// step back at least the given milliseconds of game time, or as far as the history goes, returns the number of frames rewound
+uint32_t game_rewind_time(game_t* game, uint32_t ms);
+// number of VM frames currently available to game_rewind()
+uint32_t game_rewind_num_frames(const game_t* game);
+// rasterize the draw commands recorded on the pages (see game_desc_t.use_display_list) and
+// write the pixels of the pages filled or copied lazily
+void game_resolve_pages(game_t* game);
+// call once the frame buffer is presented, game_display_info() then reports the rows changed since
+void game_reset_dirty_rows(game_t* game);
+// copy a page into dst with one byte per pixel, whatever the page storage
+void game_read_page(game_t* game, int page, uint8_t* dst);
+// like game_read_page(), the pending draws of the page are replayed into a copy, the game is left as it is
+void game_peek_page(const game_t* game, int page, uint8_t* dst);
+// pixel writes into the pages during the last frame, all zero without game_desc_t.heatmap
+game_gfx_heat_stats_t game_heatmap_stats(const game_t* game);
+// writes of each pixel of a page during the last frame, 0 without game_desc_t.heatmap
+const uint16_t* game_heatmap_counts(const game_t* game, int page);
 const char* game_get_string(game_t* game, uint16_t id);
+// decode a RT_BITMAP resource of the game data into one byte per pixel
+void game_decode_bitmap(const game_t* game, const uint8_t* src, uint8_t* dst);
+// convert num pixels of one byte each (see game_read_page()) with a palette of 16 RGBA colors like game_t.gfx.palette
+void game_convert_pixels(void* dst, const uint8_t* src, int num, const uint32_t palette[16], game_pixel_format_t fmt);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -421,6 +796,27 @@ const char* game_get_string(game_t* game, uint16_t id);
     #define GAME_ASSERT(c) assert(c)
 #endif
 
+// SIMD span kernels, define GAME_NO_SIMD to only use the portable ones
+#if !defined(GAME_NO_SIMD)
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+        #define _GAME_SIMD_SSE2 (1)
+        #include <emmintrin.h>
+        #if !defined(__EMSCRIPTEN__) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+            #define _GAME_SIMD_AVX2 (1)
+            #include <immintrin.h>
+            #if defined(_MSC_VER) && !defined(__clang__)
+                #include <intrin.h>
+                #define _GAME_TARGET_AVX2
+            #else
+                #define _GAME_TARGET_AVX2 __attribute__((target("avx2")))
+            #endif
+        #endif
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+        #define _GAME_SIMD_NEON (1)
+        #include <arm_neon.h>
+    #endif
+#endif
+
 #define _GAME_DEFAULT(val,def) (((val) != 0) ? (val) : (def))
 #define _ARRAYSIZE(a) (sizeof(a)/sizeof(a[0]))
 
@@ -436,6 +832,14 @@ typedef struct {
     _game_point_t vertices[GAME_QUAD_STRIP_MAX_VERTICES];
 } _game_quad_strip_t;
 
+// vertices of a scaled polygon relative to the corner of its bounding box
+typedef struct {
+    const int16_t* x;
+    const int16_t* y;
+    const int32_t* hx;  // at the high resolution scale, 0 without host.hires
+    const int32_t* hy;
+} _game_vertices_t;
+
 typedef struct {
     int size;
     uint32_t crc;
@@ -444,8 +848,6 @@ typedef struct {
     const uint8_t *src;
 } _unpack_context_t;
 
-typedef void (*_gfx_draw_line_t)(game_t* game, int16_t x1, int16_t x2, int16_t y, uint8_t col);
-
 static const uint8_t _font[] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x10, 0x00,
     0x28, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x24, 0x7E, 0x24, 0x24, 0x7E, 0x24, 0x00,
@@ -1356,17 +1758,52 @@ static inline uint32_t _read_le_uint32(const uint8_t *ptr) {
     return (ptr[3] << 24) | (ptr[2] << 16) | (ptr[1] << 8) | ptr[0];
 }
 
-static uint8_t _fetch_byte(game_pc_t* ptr) {
-    return *ptr->pc++;
+static inline uint8_t* _game_res_ptr(game_t* game, uint32_t pos) {
+    GAME_ASSERT(pos < GAME_MEM_BLOCK_SIZE);
+    return game->res.mem + pos;
+}
+
+static uint8_t _fetch_byte(game_t* game, game_pc_t* ptr) {
+    return game->res.mem[ptr->pc++];
 }
 
-static uint16_t _fetch_word(game_pc_t* ptr) {
-    const uint16_t i = _read_be_uint16(ptr->pc);
+static uint16_t _fetch_word(game_t* game, game_pc_t* ptr) {
+    const uint16_t i = _read_be_uint16(game->res.mem + ptr->pc);
     ptr->pc += 2;
     return i;
 }
 
+// position + 1 of each string id in the tables, 0 when missing, built by _game_strings_init()
+#define _GAME_STRINGS_MAX_ID (0x280)
+static const game_str_entry_t* const _game_strings_tables[3] = { _strings_table_fr, _strings_table_eng, _strings_table_demo };
+static uint16_t _game_strings_index[3][_GAME_STRINGS_MAX_ID];
+static bool _game_strings_ready;
+
+static void _game_strings_init(void) {
+    if (_game_strings_ready) {
+        return;
+    }
+    for (int t = 0; t < 3; t++) {
+        const game_str_entry_t* table = _game_strings_tables[t];
+        for (int i = 0; table[i].id != 0xFFFF; i++) {
+            // a repeated id keeps its first string, like the linear search
+            if ((table[i].id < _GAME_STRINGS_MAX_ID) && (_game_strings_index[t][table[i].id] == 0)) {
+                _game_strings_index[t][table[i].id] = (uint16_t)(i + 1);
+            }
+        }
+    }
+    _game_strings_ready = true;
+}
+
 static const char* _find_string(const game_str_entry_t* strings_table, int id) {
+    if (_game_strings_ready && (id >= 0) && (id < _GAME_STRINGS_MAX_ID)) {
+        for (int t = 0; t < 3; t++) {
+            if (_game_strings_tables[t] == strings_table) {
+                const uint16_t i = _game_strings_index[t][id];
+                return i ? strings_table[i - 1].str : 0;
+            }
+        }
+    }
     for (const game_str_entry_t *se = strings_table; se->id != 0xFFFF; ++se) {
         if (se->id == id) {
             return se->str;
@@ -1410,7 +1847,7 @@ static void _game_audio_sfx_prepare_instruments(game_t* game, const uint8_t* p)
             ins->volume = _read_be_uint16(p);
             game_mem_entry_t *me = &game->res.mem_list[resNum];
             if (me->status == GAME_RES_STATUS_LOADED && me->type == RT_SOUND) {
-                ins->data = me->buf_ptr;
+                ins->data = me->buf_pos;
                 _debug(GAME_DBG_SND, "Loaded instrument 0x%X n=%d volume=%d", resNum, i, ins->volume);
             } else {
                 error("Error loading instrument 0x%X", resNum);
@@ -1425,19 +1862,20 @@ static void _game_audio_sfx_load_module(game_t* game, uint16_t resNum, uint16_t
     game_audio_sfx_player_t* player = &game->audio.sfx_player;
     game_mem_entry_t *me = &game->res.mem_list[resNum];
     if (me->status == GAME_RES_STATUS_LOADED && me->type == RT_MUSIC) {
+        const uint8_t* buf = _game_res_ptr(game, me->buf_pos);
         memset(&player->sfx_mod, 0, sizeof(game_audio_sfx_module_t));
         player->sfx_mod.cur_order = pos;
-        player->sfx_mod.num_order = me->buf_ptr[0x3F];
+        player->sfx_mod.num_order = buf[0x3F];
         _debug(GAME_DBG_SND, "SfxPlayer::loadSfxModule() curOrder = 0x%X numOrder = 0x%X", player->sfx_mod.cur_order, player->sfx_mod.num_order);
-        player->sfx_mod.order_table = me->buf_ptr + 0x40;
+        player->sfx_mod.order_table = me->buf_pos + 0x40;
         if (delay == 0) {
-            player->delay = _read_be_uint16(me->buf_ptr);
+            player->delay = _read_be_uint16(buf);
         } else {
             player->delay = delay;
         }
-        player->sfx_mod.data = me->buf_ptr + 0xC0;
+        player->sfx_mod.data = me->buf_pos + 0xC0;
         _debug(GAME_DBG_SND, "SfxPlayer::loadSfxModule() eventDelay = %d ms", player->delay);
-        _game_audio_sfx_prepare_instruments(game, me->buf_ptr + 2);
+        _game_audio_sfx_prepare_instruments(game, buf + 2);
     } else {
         _warning("SfxPlayer::loadSfxModule() ec=0x%X", 0xF8);
     }
@@ -1462,7 +1900,7 @@ static int16_t _to_i16(int a) {
     }
 }
 
-static void _game_audio_sfx_mix_channel(int16_t* s, game_audio_sfx_channel_t* ch) {
+static void _game_audio_sfx_mix_channel(const uint8_t* mem, int16_t* s, game_audio_sfx_channel_t* ch) {
     if (ch->sample_len == 0) {
         return;
     }
@@ -1480,7 +1918,8 @@ static void _game_audio_sfx_mix_channel(int16_t* s, game_audio_sfx_channel_t* ch
             return;
         }
     }
-    int sample = _frac_interpolate(&ch->pos, (int8_t)ch->sample_data[pos1], (int8_t)ch->sample_data[pos2]);
+    const uint8_t* sample_data = mem + ch->sample_data;
+    int sample = _frac_interpolate(&ch->pos, (int8_t)sample_data[pos1], (int8_t)sample_data[pos2]);
     sample = *s + _to_i16(sample * ch->volume / 64);
     *s = (sample < -32768 ? -32768 : (sample > 32767 ? 32767 : sample));
 }
@@ -1500,12 +1939,13 @@ static void _game_audio_sfx_handle_pattern(game_t* game, uint8_t channel, const
     if (pat.note_1 != 0xFFFD) {
         uint16_t sample = (pat.note_2 & 0xF000) >> 12;
         if (sample != 0) {
-            uint8_t *ptr = player->sfx_mod.samples[sample - 1].data;
-            if (ptr != 0) {
+            const uint32_t data = player->sfx_mod.samples[sample - 1].data;
+            if (data != 0) {
+                const uint8_t* ptr = _game_res_ptr(game, data);
                 _debug(GAME_DBG_SND, "SfxPlayer::handlePattern() preparing sample %d", sample);
                 pat.sample_volume = player->sfx_mod.samples[sample - 1].volume;
                 pat.sample_start = 8;
-                pat.sample_buffer = ptr;
+                pat.sample_buffer = data;
                 pat.sample_len = _read_be_uint16(ptr) * 2;
                 uint16_t loopLen = _read_be_uint16(ptr + 2) * 2;
                 if (loopLen != 0) {
@@ -1558,8 +1998,8 @@ static void _game_audio_sfx_handle_pattern(game_t* game, uint8_t channel, const
 
 static void _game_audio_sfx_handle_events(game_t* game) {
     game_audio_sfx_player_t* player = &game->audio.sfx_player;
-    uint8_t order = player->sfx_mod.order_table[player->sfx_mod.cur_order];
-    const uint8_t *patternData = player->sfx_mod.data + player->sfx_mod.cur_pos + order * 1024;
+    uint8_t order = _game_res_ptr(game, player->sfx_mod.order_table)[player->sfx_mod.cur_order];
+    const uint8_t *patternData = _game_res_ptr(game, player->sfx_mod.data + player->sfx_mod.cur_pos + order * 1024);
     for (uint8_t ch = 0; ch < 4; ++ch) {
         _game_audio_sfx_handle_pattern(game, ch, patternData);
         patternData += 4;
@@ -1591,11 +2031,11 @@ static void _game_audio_sfx_mix_samples(game_t* game, int16_t* buf, int len) {
         player->samples_left -= count;
         len -= count;
         for (int i = 0; i < count; ++i) {
-            _game_audio_sfx_mix_channel(buf, &player->channels[0]);
-            _game_audio_sfx_mix_channel(buf, &player->channels[3]);
+            _game_audio_sfx_mix_channel(game->res.mem, buf, &player->channels[0]);
+            _game_audio_sfx_mix_channel(game->res.mem, buf, &player->channels[3]);
             ++buf;
-            _game_audio_sfx_mix_channel(buf, &player->channels[1]);
-            _game_audio_sfx_mix_channel(buf, &player->channels[2]);
+            _game_audio_sfx_mix_channel(game->res.mem, buf, &player->channels[1]);
+            _game_audio_sfx_mix_channel(game->res.mem, buf, &player->channels[2]);
             ++buf;
         }
     }
@@ -1620,193 +2060,2353 @@ static uint8_t* _game_gfx_get_page_ptr(game_t* game, uint8_t page) {
     return game->gfx.fbs[page].buffer;
 }
 
-static void _game_gfx_set_work_page_ptr(game_t* game, uint8_t page) {
-    game->gfx.draw_page_ptr = _game_gfx_get_page_ptr(game, page);
+static void _game_gfx_set_work_page(game_t* game, uint8_t page) {
+    GAME_ASSERT(page < 4);
+    game->gfx.draw_page = page;
 }
 
-static void _game_gfx_clear_buffer(game_t* game, int num, uint8_t color) {
-    memset(_game_gfx_get_page_ptr(game, num), color, GAME_WIDTH * GAME_HEIGHT);
+static uint8_t* _game_gfx_get_draw_page_ptr(game_t* game) {
+    return game->gfx.fbs[game->gfx.draw_page].buffer;
 }
 
-static void _game_gfx_copy_buffer(game_t* game, int dst, int src, int vscroll) {
-    if (vscroll == 0) {
-        memcpy(_game_gfx_get_page_ptr(game, dst), _game_gfx_get_page_ptr(game, src), GAME_WIDTH * GAME_HEIGHT);
-    } else if (vscroll >= -199 && vscroll <= 199) {
-        const int dy = vscroll;
-        if (dy < 0) {
-            memcpy(_game_gfx_get_page_ptr(game, dst), _game_gfx_get_page_ptr(game, src) - dy * GAME_WIDTH, (GAME_HEIGHT + dy) * GAME_WIDTH);
-        } else {
-            memcpy(_game_gfx_get_page_ptr(game, dst) + dy * GAME_WIDTH, _game_gfx_get_page_ptr(game, src), (GAME_HEIGHT - dy) * GAME_WIDTH);
+// page whose buffer holds the pixels of page, -1 when it is a solid color (see gfx.lazy)
+static int _game_gfx_page_pixels(const game_t* game, int page) {
+    const game_gfx_lazy_t* lz = &game->gfx.lazy[page];
+    switch (lz->state) {
+    case GAME_GFX_PAGE_SOLID: return -1;
+    case GAME_GFX_PAGE_ALIAS: return lz->src;
+    default: return page;
+    }
+}
+
+/*
+    Packed pages: with game_desc_t.packed_pages a page row holds 2 pixels per
+    byte, the left one in the high nibble like the packed snapshot pages, in
+    the first half of its game_framebuffer_t. The frame buffer keeps one byte
+    per pixel, the presented page is expanded into it.
+*/
+#define _GAME_PACKED_PITCH  (GAME_WIDTH / 2)    // bytes per row of a packed page
+
+static inline uint8_t _game_nibble_get(const uint8_t* row, int x) {
+    const uint8_t b = row[x >> 1];
+    return (x & 1) ? (b & 0xF) : (b >> 4);
+}
+
+static inline void _game_nibble_set(uint8_t* row, int x, uint8_t color) {
+    uint8_t* p = row + (x >> 1);
+    *p = (x & 1) ? (uint8_t)((*p & 0xF0) | (color & 0xF)) : (uint8_t)((*p & 0x0F) | (color << 4));
+}
+
+// pack 2*n pixels of one byte each into n bytes
+static void _game_packed_pack(uint8_t* dst, const uint8_t* src, size_t n) {
+    const uint8_t* end = dst + n;
+    #if defined(_GAME_SIMD_SSE2)
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        const __m128i low = _mm_set1_epi16(0x00FF);
+        for (; (end - dst) >= 16; dst += 16, src += 32) {
+            // in each 16 bit lane: left pixel in the low byte, right pixel in the high byte
+            const __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)src), nibble);
+            const __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + 16)), nibble);
+            const __m128i pa = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(a, 4), _mm_srli_epi16(a, 8)), low);
+            const __m128i pb = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(b, 4), _mm_srli_epi16(b, 8)), low);
+            _mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(pa, pb));
         }
+    #elif defined(_GAME_SIMD_NEON)
+        const uint8x16_t nibble = vdupq_n_u8(0x0F);
+        for (; (end - dst) >= 16; dst += 16, src += 32) {
+            const uint8x16x2_t v = vld2q_u8(src);
+            vst1q_u8(dst, vorrq_u8(vshlq_n_u8(v.val[0], 4), vandq_u8(v.val[1], nibble)));
+        }
+    #endif
+    for (; dst < end; dst++, src += 2) {
+        *dst = (uint8_t)((src[0] << 4) | (src[1] & 0xF));
     }
 }
 
-static void _game_gfx_draw_buffer(game_t* game, int num) {
-    const uint8_t *src = _game_gfx_get_page_ptr(game, num);
-    memcpy(game->gfx.fb, src, GAME_WIDTH*GAME_HEIGHT);
+// expand n packed bytes into 2*n pixels of one byte each
+static void _game_packed_expand(uint8_t* dst, const uint8_t* src, size_t n) {
+    const uint8_t* end = src + n;
+    #if defined(_GAME_SIMD_SSE2)
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        for (; (end - src) >= 16; src += 16, dst += 32) {
+            const __m128i v = _mm_loadu_si128((const __m128i*)src);
+            const __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+            const __m128i lo = _mm_and_si128(v, nibble);
+            _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi8(hi, lo));
+            _mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi8(hi, lo));
+        }
+    #elif defined(_GAME_SIMD_NEON)
+        const uint8x16_t nibble = vdupq_n_u8(0x0F);
+        for (; (end - src) >= 16; src += 16, dst += 32) {
+            const uint8x16_t v = vld1q_u8(src);
+            const uint8x16x2_t p = { { vshrq_n_u8(v, 4), vandq_u8(v, nibble) } };
+            vst2q_u8(dst, p);
+        }
+    #endif
+    for (; src < end; src++, dst += 2) {
+        dst[0] = *src >> 4;
+        dst[1] = *src & 0xF;
+    }
 }
 
-static void _game_gfx_draw_char(game_t* game, uint8_t c, uint16_t x, uint16_t y, uint8_t color) {
-    if (x <= GAME_WIDTH - 8 && y <= GAME_HEIGHT - 8) {
-        const uint8_t *ft = _font + (c - 0x20) * 8;
-        const int offset = (x + y * GAME_WIDTH);
-        for (int j = 0; j < 8; ++j) {
-            const uint8_t ch = ft[j];
-            for (int i = 0; i < 8; ++i) {
-                if (ch & (1 << (7 - i))) {
-                    game->gfx.draw_page_ptr[offset + j * GAME_WIDTH + i] = color;
+/*
+    Planar to chunky: the bitmaps of the game data have 4 bit planes, pixel
+    x of a row is bit 7-(x&7) of one byte in each plane. The Amiga and DOS
+    data store the planes one after the other, the Atari data interleaves
+    the 16 bit words of the 4 planes.
+*/
+
+// the 8 bits of a byte spread over 8 pixels, bit 7 to the left one, as 0xFF bytes
+// (or 0xF nibbles for the packed pages), used as masks of the pixels of a font row
+static uint64_t _game_spread_bytes[256];
+static uint32_t _game_spread_nibbles[256];
+
+static void _game_init_spread(void) {
+    if (_game_spread_bytes[1] == 0) {
+        for (int ch = 0; ch < 256; ch++) {
+            uint8_t bytes[8] = {0};
+            uint8_t nibbles[4] = {0};
+            for (int i = 0; i < 8; i++) {
+                if (ch & (0x80 >> i)) {
+                    bytes[i] = 0xFF;
+                    nibbles[i >> 1] |= (i & 1) ? 0x0F : 0xF0;
                 }
             }
+            // in memory order, so the masks match the pixels loaded with memcpy
+            memcpy(&_game_spread_nibbles[ch], nibbles, 4);
+            memcpy(&_game_spread_bytes[ch], bytes, 8);
         }
     }
 }
 
-static void _game_gfx_draw_string_char(game_t* game, int buffer, uint8_t color, char c, const _game_point_t *pt) {
-    _game_gfx_set_work_page_ptr(game, buffer);
-    _game_gfx_draw_char(game, c, pt->x, pt->y, color);
+// convert n groups of 16 pixels, the 2 bytes of plane p of group i are at src + i * step + p * plane,
+// into one byte per pixel, or into packed bytes when packed is set
+static void _game_planar_to_chunky(uint8_t* dst, const uint8_t* src, int n, int step, int plane, bool packed) {
+    int i = 0;
+    if (!packed) {
+        #if defined(_GAME_SIMD_SSE2)
+            const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, (char)0x80, 1, 2, 4, 8, 16, 32, 64, (char)0x80);
+            for (; i < n; i++, src += step, dst += 16) {
+                __m128i c = _mm_setzero_si128();
+                for (int p = 0; p < 4; p++) {
+                    const uint8_t* s = src + p * plane;
+                    // each of the 2 bytes in 8 lanes, then one bit per lane
+                    __m128i v = _mm_cvtsi32_si128(s[0] | (s[1] << 8));
+                    v = _mm_unpacklo_epi8(v, v);
+                    v = _mm_unpacklo_epi16(v, v);
+                    v = _mm_unpacklo_epi32(v, v);
+                    v = _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+                    c = _mm_or_si128(c, _mm_and_si128(v, _mm_set1_epi8((char)(1 << p))));
+                }
+                _mm_storeu_si128((__m128i*)dst, c);
+            }
+        #elif defined(_GAME_SIMD_NEON)
+            static const uint8_t _bits[16] = { 0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1, 0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1 };
+            const uint8x16_t bits = vld1q_u8(_bits);
+            for (; i < n; i++, src += step, dst += 16) {
+                uint8x16_t c = vdupq_n_u8(0);
+                for (int p = 0; p < 4; p++) {
+                    const uint8_t* s = src + p * plane;
+                    const uint8x16_t v = vcombine_u8(vdup_n_u8(s[0]), vdup_n_u8(s[1]));
+                    c = vorrq_u8(c, vandq_u8(vtstq_u8(v, bits), vdupq_n_u8((uint8_t)(1 << p))));
+                }
+                vst1q_u8(dst, c);
+            }
+        #endif
+        for (; i < n; i++, src += step, dst += 16) {
+            for (int h = 0; h < 2; h++) {
+                uint64_t v = 0;
+                for (int p = 0; p < 4; p++) {
+                    v |= _game_spread_bytes[src[p * plane + h]] & (0x0101010101010101ULL << p);
+                }
+                memcpy(dst + h * 8, &v, 8);
+            }
+        }
+    } else {
+        for (; i < n; i++, src += step, dst += 8) {
+            for (int h = 0; h < 2; h++) {
+                uint32_t v = 0;
+                for (int p = 0; p < 4; p++) {
+                    v |= _game_spread_nibbles[src[p * plane + h]] & (0x11111111U << p);
+                }
+                memcpy(dst + h * 4, &v, 4);
+            }
+        }
+    }
 }
 
-static void _game_gfx_drawPoint(game_t* game, int16_t x, int16_t y, uint8_t color) {
-    const int offset = (y * GAME_WIDTH + x);
-    switch (color) {
-    case _GFX_COL_ALPHA:
-        game->gfx.draw_page_ptr[offset] |= 8;
-        break;
-    case _GFX_COL_PAGE:
-        game->gfx.draw_page_ptr[offset] = *(game->gfx.fbs[0].buffer + offset);
-        break;
-    default:
-        game->gfx.draw_page_ptr[offset] = color;
-        break;
+// convert a RT_BITMAP resource of the given data type
+static void _game_decode_planar(int data_type, const uint8_t* src, uint8_t* dst, bool packed) {
+    const int groups = GAME_WIDTH * GAME_HEIGHT / 16;
+    if (data_type == DT_ATARI) {
+        _game_planar_to_chunky(dst, src, groups, 8, 2, packed);
+    } else {
+        _game_planar_to_chunky(dst, src, groups, 2, GAME_WIDTH * GAME_HEIGHT / 8, packed);
     }
 }
 
-static void _game_gfx_draw_point(game_t* game, int buffer, uint8_t color, const _game_point_t *pt) {
-    _game_gfx_set_work_page_ptr(game, buffer);
-    _game_gfx_drawPoint(game, pt->x, pt->y, color);
+static void _game_gfx_hires_init(game_t* game, int scale) {
+    GAME_ASSERT(scale > 1 && scale <= GAME_MAX_SCALE);
+    const size_t page_size = (size_t)(GAME_WIDTH * scale) * (size_t)(GAME_HEIGHT * scale);
+    game_hires_t* hr = (game_hires_t*)_game_malloc(game, sizeof(game_hires_t) + 5 * page_size);
+    memset(hr, 0, sizeof(game_hires_t) + 5 * page_size);
+    hr->scale = scale;
+    hr->width = GAME_WIDTH * scale;
+    hr->height = GAME_HEIGHT * scale;
+    uint8_t* pixels = (uint8_t*)(hr + 1);
+    for (int i = 0; i < 4; i++) {
+        hr->fbs[i] = pixels + i * page_size;
+    }
+    hr->fb = pixels + 4 * page_size;
+    game->host.hires = hr;
 }
 
-static uint32_t _calc_step(const _game_point_t* p1, const _game_point_t* p2, uint16_t* dy) {
-    *dy = p2->y - p1->y;
-    uint16_t delta = (*dy <= 1) ? 1 : *dy;
-    return ((p2->x - p1->x) * (0x4000 / delta)) << 2;
+static void _game_gfx_hires_discard(game_t* game) {
+    if (game->host.hires) {
+        _game_free(game, game->host.hires);
+        game->host.hires = 0;
+    }
 }
 
-
-static void _game_gfx_draw_line_p(game_t* game, int16_t x1, int16_t x2, int16_t y, uint8_t color) {
-    (void)color;
-    if (game->gfx.draw_page_ptr == game->gfx.fbs[0].buffer) {
-        return;
+// nearest neighbour upscaling of a 320x200 image
+static void _game_gfx_hires_upscale(const game_hires_t* hr, uint8_t* dst, const uint8_t* src) {
+    const int s = hr->scale;
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        uint8_t* row = dst;
+        for (int x = 0; x < GAME_WIDTH; x++) {
+            memset(row, src[x], s);
+            row += s;
+        }
+        for (int j = 1; j < s; j++) {
+            memcpy(dst + j * hr->width, dst, hr->width);
+        }
+        src += GAME_WIDTH;
+        dst += s * hr->width;
     }
-    const int16_t xmax = _MAX(x1, x2);
-    const int16_t xmin = _MIN(x1, x2);
-    const int w = xmax - xmin + 1;
-    const int offset = (y * GAME_WIDTH + xmin);
-    memcpy(game->gfx.draw_page_ptr + offset, game->gfx.fbs[0].buffer + offset, w);
 }
 
-static void _game_gfx_draw_line_n(game_t* game, int16_t x1, int16_t x2, int16_t y, uint8_t color) {
-    const int16_t xmax = _MAX(x1, x2);
-    const int16_t xmin = _MIN(x1, x2);
-    const int w = xmax - xmin + 1;
-    const int offset = (y * GAME_WIDTH + xmin);
-    memset(game->gfx.draw_page_ptr + offset, color, w);
+// rebuild the high resolution pages from the 320x200 ones
+static void _game_gfx_hires_sync(game_t* game) {
+    game_hires_t* hr = game->host.hires;
+    if (hr) {
+        for (int i = 0; i < 4; i++) {
+            _game_gfx_hires_upscale(hr, hr->fbs[i], game->gfx.fbs[i].buffer);
+        }
+        _game_gfx_hires_upscale(hr, hr->fb, game->gfx.fb);
+    }
 }
 
-static void _game_gfx_draw_line_trans(game_t* game, int16_t x1, int16_t x2, int16_t y, uint8_t color) {
-    (void)color;
-    const int16_t xmax = _MAX(x1, x2);
-    const int16_t xmin = _MIN(x1, x2);
-    const int w = xmax - xmin + 1;
-    const int offset = (y * GAME_WIDTH + xmin);
-    for (int i = 0; i < w; ++i) {
-        game->gfx.draw_page_ptr[offset + i] |= 8;
+/*
+    The raster functions below write the rows ystart to yend-1 of the work page
+    (in 320x200 rows), so a page can be rasterized in horizontal bands.
+    They only read the game state, the bands may run in parallel.
+*/
+static void _game_gfx_hires_draw_char(game_t* game, uint8_t c, uint16_t x, uint16_t y, uint8_t color, int ystart, int yend) {
+    const game_hires_t* hr = game->host.hires;
+    const int s = hr->scale;
+    const uint8_t *ft = _font + (c - 0x20) * 8;
+    uint8_t* dst = hr->fbs[game->gfx.draw_page] + (x + y * hr->width) * s;
+    const int jmin = _MAX(ystart - y, 0) * s;
+    const int jmax = _MIN(yend - y, 8) * s;
+    for (int j = jmin; j < jmax; ++j) {
+        const uint8_t ch = ft[j / s];
+        for (int i = 0; i < 8; ++i) {
+            if (ch & (1 << (7 - i))) {
+                memset(dst + j * hr->width + i * s, color, s);
+            }
+        }
     }
 }
 
-static void _game_gfx_draw_bitmap(game_t* game, int buffer, const uint8_t *data, int w, int h, int fmt) {
-    if (fmt == _GFX_FMT_CLUT && GAME_WIDTH == w && GAME_HEIGHT == h) {
-        memcpy(_game_gfx_get_page_ptr(game, buffer), data, w * h);
-        return;
+static void _game_gfx_hires_draw_point(game_t* game, int16_t x, int16_t y, uint8_t color) {
+    const game_hires_t* hr = game->host.hires;
+    const int s = hr->scale;
+    const int offset = (y * hr->width + x) * s;
+    for (int j = 0; j < s; j++) {
+        uint8_t* dst = hr->fbs[game->gfx.draw_page] + offset + j * hr->width;
+        switch (color) {
+        case _GFX_COL_ALPHA:
+            for (int i = 0; i < s; i++) {
+                dst[i] |= 8;
+            }
+            break;
+        case _GFX_COL_PAGE: {
+            const int src = _game_gfx_page_pixels(game, 0);
+            if (src < 0) {
+                memset(dst, game->gfx.lazy[0].color, s);
+            } else {
+                memmove(dst, hr->fbs[src] + offset + j * hr->width, s);
+            }
+            break;
+        }
+        default:
+            memset(dst, color, s);
+            break;
+        }
     }
-    _warning("GraphicsSokol::drawBitmap() unhandled fmt %d w %d h %d", fmt, w, h);
 }
 
-static void _game_gfx_draw_polygon(game_t* game, uint8_t color, const _game_quad_strip_t* quadStrip) {
-    const _game_quad_strip_t* qs = quadStrip;
-
-    int i = 0;
-    int j = qs->num_vertices - 1;
-
-    int16_t x2 = qs->vertices[i].x;
-    int16_t x1 = qs->vertices[j].x;
-    int16_t hliney = _MIN(qs->vertices[i].y, qs->vertices[j].y);
+// count the writes of w pixels from x on the row y of page
+static void _game_gfx_heat_span(game_gfx_heatmap_t* hm, int page, int kind, int y, int x, int w) {
+    uint16_t* counts = hm->counts[hm->cur][page] + y * GAME_WIDTH + x;
+    for (int i = 0; i < w; i++) {
+        counts[i] += (counts[i] < UINT16_MAX);
+    }
+    hm->rows[page][kind][y] += w;
+}
 
-    ++i;
-    --j;
+static void _game_gfx_heat_rows(game_t* game, int page, int kind, int ystart, int yend) {
+    if (game->host.heatmap) {
+        for (int y = ystart; y < yend; y++) {
+            _game_gfx_heat_span(game->host.heatmap, page, kind, y, 0, GAME_WIDTH);
+        }
+    }
+}
 
-    _gfx_draw_line_t pdl;
+static int _game_gfx_heat_kind(uint8_t color) {
     switch (color) {
-    default:
-        pdl = &_game_gfx_draw_line_n;
-        break;
-    case _GFX_COL_PAGE:
-        pdl = &_game_gfx_draw_line_p;
-        break;
-    case _GFX_COL_ALPHA:
-        pdl = &_game_gfx_draw_line_trans;
-        break;
+    case _GFX_COL_ALPHA: return GAME_GFX_WRITE_ALPHA;
+    case _GFX_COL_PAGE: return GAME_GFX_WRITE_PAGE;
+    default: return GAME_GFX_WRITE_SOLID;
     }
+}
 
-    uint32_t cpt1 = x1 << 16;
-    uint32_t cpt2 = x2 << 16;
-
-    int numVertices = qs->num_vertices;
-    while (1) {
-        numVertices -= 2;
-        if (numVertices == 0) {
-            return;
+// the counts of the frame are complete, keep them for game_heatmap_stats() and start over
+static void _game_gfx_heat_flip(game_t* game) {
+    game_gfx_heatmap_t* hm = game->host.heatmap;
+    if (!hm) {
+        return;
+    }
+    game_gfx_heat_stats_t stats = {0};
+    for (int page = 0; page < 4; page++) {
+        for (int kind = 0; kind < GAME_GFX_WRITE_NUM; kind++) {
+            for (int y = 0; y < GAME_HEIGHT; y++) {
+                stats.writes[kind] += hm->rows[page][kind][y];
+            }
         }
-        uint16_t h;
-        uint32_t step1 = _calc_step(&qs->vertices[j + 1], &qs->vertices[j], &h);
-        uint32_t step2 = _calc_step(&qs->vertices[i - 1], &qs->vertices[i], &h);
-
-        ++i;
-        --j;
+        const uint16_t* counts = hm->counts[hm->cur][page];
+        for (int i = 0; i < GAME_WIDTH * GAME_HEIGHT; i++) {
+            stats.pixels += (counts[i] != 0);
+        }
+    }
+    uint64_t writes = 0;
+    for (int kind = 0; kind < GAME_GFX_WRITE_NUM; kind++) {
+        writes += stats.writes[kind];
+    }
+    stats.overdraw = stats.pixels ? (float)writes / (float)stats.pixels : 0.0f;
+    hm->stats = stats;
+    hm->cur ^= 1;
+    memset(hm->counts[hm->cur], 0, sizeof(hm->counts[hm->cur]));
+    memset(hm->rows, 0, sizeof(hm->rows));
+}
 
-        cpt1 = (cpt1 & 0xFFFF0000) | 0x7FFF;
-        cpt2 = (cpt2 & 0xFFFF0000) | 0x8000;
+static void _game_gfx_heat_init(game_t* game) {
+    game_gfx_heatmap_t* hm = (game_gfx_heatmap_t*)_game_malloc(game, sizeof(game_gfx_heatmap_t));
+    memset(hm, 0, sizeof(game_gfx_heatmap_t));
+    game->host.heatmap = hm;
+}
 
-        if (h == 0) {
-            cpt1 += step1;
-            cpt2 += step2;
-        } else {
-            while (h--) {
-                if (hliney >= 0) {
-                    x1 = cpt1 >> 16;
-                    x2 = cpt2 >> 16;
-                    if (x1 < GAME_WIDTH && x2 >= 0) {
-                        if (x1 < 0) x1 = 0;
-                        if (x2 >= GAME_WIDTH) x2 = GAME_WIDTH - 1;
-                        (*pdl)(game, x1, x2, hliney, color);
-                    }
-                }
-                cpt1 += step1;
-                cpt2 += step2;
-                ++hliney;
-                if (hliney >= GAME_HEIGHT) return;
-            }
-        }
+static void _game_gfx_heat_discard(game_t* game) {
+    if (game->host.heatmap) {
+        _game_free(game, game->host.heatmap);
+        game->host.heatmap = 0;
     }
 }
 
-static void _game_gfx_draw_quad_strip(game_t* game, int buffer, uint8_t color, const _game_quad_strip_t *qs) {
-    _game_gfx_set_work_page_ptr(game, buffer);
-    _game_gfx_draw_polygon(game, color, qs);
+game_gfx_heat_stats_t game_heatmap_stats(const game_t* game) {
+    GAME_ASSERT(game && game->valid);
+    const game_gfx_heatmap_t* hm = game->host.heatmap;
+    return hm ? hm->stats : (game_gfx_heat_stats_t){0};
 }
 
-// Video
-static void _game_video_read_palette_ega(const uint8_t *buf, int num, uint32_t pal[16]) {
+const uint16_t* game_heatmap_counts(const game_t* game, int page) {
+    GAME_ASSERT(game && game->valid && (page >= 0) && (page < 4));
+    const game_gfx_heatmap_t* hm = game->host.heatmap;
+    return hm ? hm->counts[hm->cur ^ 1][page] : 0;
+}
+
+static void _game_gfx_draw_char(game_t* game, uint8_t c, uint16_t x, uint16_t y, uint8_t color, int ystart, int yend) {
+    if (x <= GAME_WIDTH - 8 && y <= GAME_HEIGHT - 8) {
+        if (game->host.hires) {
+            _game_gfx_hires_draw_char(game, c, x, y, color, ystart, yend);
+        }
+        const uint8_t *ft = _font + (c - 0x20) * 8;
+        const bool packed = game->host.packed;
+        const int pitch = packed ? _GAME_PACKED_PITCH : GAME_WIDTH;
+        uint8_t* dst = _game_gfx_get_draw_page_ptr(game) + y * pitch;
+        const int jmax = _MIN(yend - y, 8);
+        for (int j = _MAX(ystart - y, 0); j < jmax; ++j) {
+            const uint8_t ch = ft[j];
+            uint8_t* row = dst + j * pitch;
+            // each font row is one masked store of the 8 pixels
+            if (!packed) {
+                const uint64_t mask = _game_spread_bytes[ch];
+                uint64_t v;
+                memcpy(&v, row + x, 8);
+                v = (v & ~mask) | ((0x0101010101010101ULL * color) & mask);
+                memcpy(row + x, &v, 8);
+            } else if ((x & 1) == 0) {
+                const uint32_t mask = _game_spread_nibbles[ch];
+                uint32_t v;
+                memcpy(&v, row + (x >> 1), 4);
+                v = (v & ~mask) | ((0x11111111U * (color & 0xF)) & mask);
+                memcpy(row + (x >> 1), &v, 4);
+            } else {
+                for (int i = 0; i < 8; ++i) {
+                    if (ch & (0x80 >> i)) {
+                        _game_nibble_set(row, x + i, color);
+                    }
+                }
+            }
+            if (game->host.heatmap) {
+                for (int i = 0; i < 8; ++i) {
+                    if (ch & (0x80 >> i)) {
+                        _game_gfx_heat_span(game->host.heatmap, game->gfx.draw_page, GAME_GFX_WRITE_GLYPH, y + j, x + i, 1);
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void _game_gfx_drawPoint(game_t* game, int16_t x, int16_t y, uint8_t color, int ystart, int yend) {
+    if (y < ystart || y >= yend) {
+        return;
+    }
+    if (game->host.hires) {
+        _game_gfx_hires_draw_point(game, x, y, color);
+    }
+    uint8_t* dst = _game_gfx_get_draw_page_ptr(game);
+    if (game->host.packed) {
+        uint8_t* row = dst + y * _GAME_PACKED_PITCH;
+        switch (color) {
+        case _GFX_COL_ALPHA:
+            row[x >> 1] |= (x & 1) ? 0x08 : 0x80;
+            break;
+        case _GFX_COL_PAGE: {
+            const int src = _game_gfx_page_pixels(game, 0);
+            _game_nibble_set(row, x, (src < 0) ? game->gfx.lazy[0].color : _game_nibble_get(game->gfx.fbs[src].buffer + y * _GAME_PACKED_PITCH, x));
+            break;
+        }
+        default:
+            _game_nibble_set(row, x, color);
+            break;
+        }
+        if (game->host.heatmap) {
+            _game_gfx_heat_span(game->host.heatmap, game->gfx.draw_page, _game_gfx_heat_kind(color), y, x, 1);
+        }
+        return;
+    }
+    const int offset = (y * GAME_WIDTH + x);
+    switch (color) {
+    case _GFX_COL_ALPHA:
+        dst[offset] |= 8;
+        break;
+    case _GFX_COL_PAGE: {
+        const int src = _game_gfx_page_pixels(game, 0);
+        dst[offset] = (src < 0) ? game->gfx.lazy[0].color : game->gfx.fbs[src].buffer[offset];
+        break;
+    }
+    default:
+        dst[offset] = color;
+        break;
+    }
+    if (game->host.heatmap) {
+        _game_gfx_heat_span(game->host.heatmap, game->gfx.draw_page, _game_gfx_heat_kind(color), y, x, 1);
+    }
+}
+
+static void _game_gfx_fill_page(game_t* game, int page, uint8_t color, int ystart, int yend) {
+    const game_hires_t* hr = game->host.hires;
+    if (hr) {
+        memset(hr->fbs[page] + ystart * hr->scale * hr->width, color, (size_t)(yend - ystart) * hr->scale * hr->width);
+    }
+    if (game->host.packed) {
+        memset(_game_gfx_get_page_ptr(game, page) + ystart * _GAME_PACKED_PITCH, (color & 0xF) * 0x11, (yend - ystart) * _GAME_PACKED_PITCH);
+    } else {
+        memset(_game_gfx_get_page_ptr(game, page) + ystart * GAME_WIDTH, color, (yend - ystart) * GAME_WIDTH);
+    }
+    _game_gfx_heat_rows(game, page, GAME_GFX_WRITE_CLEAR, ystart, yend);
+}
+
+static void _game_gfx_draw_polygon_data(game_t* game, uint8_t color, uint16_t zoom, const _game_point_t *pt, const uint8_t* p, int ystart, int yend, bool cover);
+static void _game_gfx_cover_fill(game_t* game, uint8_t color, int ystart, int yend);
+
+// Display list: with game_desc_t.use_display_list the draws of a page are
+// recorded and only rasterized when the page pixels are read or overwritten.
+static void _game_gfx_lists_init(game_t* game) {
+    game->host.lists = (game_gfx_list_t*)_game_malloc(game, 4 * sizeof(game_gfx_list_t));
+    memset(game->host.lists, 0, 4 * sizeof(game_gfx_list_t));
+}
+
+static void _game_gfx_lists_discard(game_t* game) {
+    if (game->host.lists) {
+        _game_free(game, game->host.lists);
+        game->host.lists = 0;
+    }
+}
+
+static void _game_gfx_reset_list(game_t* game, int page) {
+    game_gfx_list_t* list = &game->host.lists[page];
+    list->num_cmds = 0;
+    list->data_size = 0;
+    list->reads_page0 = false;
+}
+
+static void _game_gfx_resolve(game_t* game, int page);
+
+// must be called before the pixels of a page change
+static void _game_gfx_begin_write(game_t* game, int page) {
+    if (page == 0) {
+        // the pending copies from page 0 have to see it unchanged
+        for (int i = 1; i < 4; i++) {
+            if (game->host.lists[i].reads_page0) {
+                _game_gfx_resolve(game, i);
+            }
+        }
+    }
+}
+
+// the command overwrites the pixels it covers whatever they were
+static bool _game_gfx_is_opaque(const game_gfx_cmd_t* cmd) {
+    switch (cmd->type) {
+    case GAME_GFX_CMD_FILL:
+        return true;
+    case GAME_GFX_CMD_POLYGON:
+        return (cmd->color != _GFX_COL_ALPHA) && (cmd->color != _GFX_COL_PAGE);
+    default:
+        return false;
+    }
+}
+
+static void _game_gfx_replay_cmd(game_t* game, const game_gfx_list_t* list, const game_gfx_cmd_t* cmd, int ystart, int yend, bool cover) {
+    if (cmd->bottom < ystart || cmd->top >= yend) {
+        return;
+    }
+    const _game_point_t pt = { .x = cmd->x, .y = cmd->y };
+    switch (cmd->type) {
+    case GAME_GFX_CMD_FILL:
+        if (cover) {
+            _game_gfx_cover_fill(game, cmd->color, ystart, yend);
+        } else {
+            _game_gfx_fill_page(game, game->gfx.draw_page, cmd->color, ystart, yend);
+        }
+        break;
+    case GAME_GFX_CMD_POLYGON:
+        _game_gfx_draw_polygon_data(game, cmd->color, cmd->zoom, &pt, list->data + cmd->data, ystart, yend, cover);
+        break;
+    case GAME_GFX_CMD_CHAR:
+        _game_gfx_draw_char(game, (uint8_t)cmd->data, pt.x, pt.y, cmd->color, ystart, yend);
+        break;
+    }
+}
+
+// rasterize the commands which reach the rows ystart to yend-1 into the work page, in recording
+// order or, with game_desc_t.front_to_back, each run of opaque commands in the reverse order
+// writing only the pixels not covered yet, the other commands keep their order around the runs
+static void _game_gfx_replay(game_t* game, const game_gfx_list_t* list, int ystart, int yend) {
+    for (int i = 0; i < list->num_cmds; i++) {
+        int end = i + 1;
+        if (game->host.front_to_back && _game_gfx_is_opaque(&list->cmds[i])) {
+            while ((end < list->num_cmds) && _game_gfx_is_opaque(&list->cmds[end])) {
+                end++;
+            }
+        }
+        if (end - i == 1) {
+            _game_gfx_replay_cmd(game, list, &list->cmds[i], ystart, yend, false);
+            continue;
+        }
+        game_gfx_cover_t* cover = game->host.cover;
+        const size_t words = GAME_WIDTH / 64;
+        memset(cover->rows + ystart * words, 0, (yend - ystart) * words * sizeof(uint64_t));
+        if (game->host.hires) {
+            const int s = game->host.hires->scale;
+            memset(cover->hires_rows + ystart * s * s * words, 0, (yend - ystart) * s * s * words * sizeof(uint64_t));
+        }
+        for (int j = end - 1; j >= i; j--) {
+            _game_gfx_replay_cmd(game, list, &list->cmds[j], ystart, yend, true);
+        }
+        i = end - 1;
+    }
+}
+
+static void _game_gfx_replay_band(int band, void* band_data) {
+    game_t* game = (game_t*)band_data;
+    const int num_bands = game->host.raster.num_bands;
+    _game_gfx_replay(game, &game->host.lists[game->gfx.draw_page], band * GAME_HEIGHT / num_bands, (band + 1) * GAME_HEIGHT / num_bands);
+}
+
+static void _game_gfx_resolve(game_t* game, int page) {
+    game_gfx_list_t* list = &game->host.lists[page];
+    if (list->num_cmds == 0) {
+        return;
+    }
+    _game_gfx_begin_write(game, page);
+    const uint8_t draw_page = game->gfx.draw_page;
+    _game_gfx_set_work_page(game, page);
+    if (game->host.raster.func && game->host.raster.num_bands > 1) {
+        game->host.raster.func(game->host.raster.num_bands, _game_gfx_replay_band, game, game->host.raster.user_data);
+    } else {
+        _game_gfx_replay(game, list, 0, GAME_HEIGHT);
+    }
+    game_gfx_cover_t* cover = game->host.cover;
+    if (cover) {
+        for (int y = 0; y < GAME_HEIGHT; y++) {
+            game->host.overdraw.drawn += cover->drawn[y];
+            game->host.overdraw.written += cover->written[y];
+        }
+        memset(cover->drawn, 0, sizeof(cover->drawn));
+        memset(cover->written, 0, sizeof(cover->written));
+    }
+    _game_gfx_set_work_page(game, draw_page);
+    _game_gfx_reset_list(game, page);
+}
+
+static game_gfx_cmd_t* _game_gfx_record(game_t* game, int page, uint8_t type, uint8_t color, const _game_point_t *pt, int data_size) {
+    GAME_ASSERT(page >= 0 && page < 4);
+    game_gfx_list_t* list = &game->host.lists[page];
+    if ((list->num_cmds == GAME_GFX_MAX_CMDS) || (list->data_size + data_size > GAME_GFX_MAX_DATA)) {
+        _game_gfx_resolve(game, page);
+    }
+    if (color == _GFX_COL_PAGE && page != 0 && type != GAME_GFX_CMD_FILL) {
+        // page 0 has to be up to date when the command is replayed
+        _game_gfx_resolve(game, 0);
+        list->reads_page0 = true;
+    }
+    _game_gfx_set_work_page(game, page);
+    game_gfx_cmd_t* cmd = &list->cmds[list->num_cmds++];
+    cmd->type = type;
+    cmd->color = color;
+    cmd->zoom = 0;
+    cmd->x = pt->x;
+    cmd->y = pt->y;
+    cmd->top = 0;
+    cmd->bottom = GAME_HEIGHT - 1;
+    cmd->data = list->data_size;
+    list->data_size += data_size;
+    return cmd;
+}
+
+static void _game_gfx_materialize(game_t* game, int page);
+
+void game_resolve_pages(game_t* game) {
+    GAME_ASSERT(game && game->valid);
+    if (game->host.use_display_list) {
+        for (int i = 0; i < 4; i++) {
+            _game_gfx_resolve(game, i);
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        _game_gfx_materialize(game, i);
+    }
+}
+
+static void _game_gfx_read_pixels(const game_t* game, int page, uint8_t* dst) {
+    const int src = _game_gfx_page_pixels(game, page);
+    if (src < 0) {
+        memset(dst, game->gfx.lazy[page].color & 0xF, GAME_WIDTH * GAME_HEIGHT);
+    } else if (game->host.packed) {
+        _game_packed_expand(dst, game->gfx.fbs[src].buffer, GAME_WIDTH * GAME_HEIGHT / 2);
+    } else {
+        memcpy(dst, game->gfx.fbs[src].buffer, GAME_WIDTH * GAME_HEIGHT);
+    }
+}
+
+void game_read_page(game_t* game, int page, uint8_t* dst) {
+    GAME_ASSERT(game && game->valid && (page >= 0) && (page < 4) && dst);
+    if (game->host.use_display_list) {
+        _game_gfx_resolve(game, page);
+    }
+    _game_gfx_read_pixels(game, page, dst);
+}
+
+void game_peek_page(const game_t* game, int page, uint8_t* dst) {
+    GAME_ASSERT(game && game->valid && (page >= 0) && (page < 4) && dst);
+    const game_gfx_list_t* list = game->host.lists ? &game->host.lists[page] : 0;
+    if (!list || (list->num_cmds == 0)) {
+        _game_gfx_read_pixels(game, page, dst);
+        return;
+    }
+    // a copy of the game replays the commands into copies of the page and of the page 0 it may read,
+    // without the high resolution pages, the counters and the bands which belong to the game
+    static game_t im;
+    memcpy(&im, game, sizeof(game_t));
+    im.host.hires = 0;
+    im.host.cover = 0;
+    im.host.front_to_back = false;
+    im.host.heatmap = 0;
+    game_framebuffer_t* fbs = (game_framebuffer_t*)_game_malloc(&im, 4 * sizeof(game_framebuffer_t));
+    const int src = _game_gfx_page_pixels(game, page);
+    if (src < 0) {
+        const uint8_t color = game->gfx.lazy[page].color & 0xF;
+        memset(fbs[page].buffer, game->host.packed ? color * 0x11 : color, sizeof(fbs[page].buffer));
+    } else {
+        memcpy(fbs[page].buffer, game->gfx.fbs[src].buffer, sizeof(fbs[page].buffer));
+    }
+    const int src0 = _game_gfx_page_pixels(game, 0);
+    if ((src0 >= 0) && (src0 != page)) {
+        memcpy(fbs[src0].buffer, game->gfx.fbs[src0].buffer, sizeof(fbs[src0].buffer));
+    }
+    im.gfx.fbs = fbs;
+    im.gfx.lazy[page].state = GAME_GFX_PAGE_PIXELS;
+    _game_gfx_set_work_page(&im, (uint8_t)page);
+    _game_gfx_replay(&im, list, 0, GAME_HEIGHT);
+    _game_gfx_read_pixels(&im, page, dst);
+    _game_free(&im, fbs);
+}
+
+/*
+    Dirty rows: each page and the frame buffer remember the page they were
+    last copied from in full and the rows changed in either of them since,
+    so the next copy between them only moves these rows.
+*/
+#define _GAME_GFX_FB (4)    // index of the frame buffer in gfx.mirror and gfx.diff
+
+static void _game_gfx_add_rows(game_gfx_rows_t* rows, int top, int bottom) {
+    rows->top = _MIN(rows->top, top);
+    rows->bottom = _MAX(rows->bottom, bottom);
+}
+
+static void _game_gfx_reset_rows(game_t* game) {
+    for (int i = 0; i < 5; i++) {
+        game->gfx.mirror[i] = -1;
+        game->gfx.diff[i] = (game_gfx_rows_t){ GAME_HEIGHT, -1 };
+    }
+    game->gfx.fb_dirty = (game_gfx_rows_t){ 0, GAME_HEIGHT - 1 };
+    game->gfx.presented = _GAME_GFX_FB;
+}
+
+static void _game_gfx_mirror_page(game_t* game, int dst, int src);
+
+// the pixels of page are about to change, the pages still sharing them get their own copy
+static void _game_gfx_detach(game_t* game, int page) {
+    for (int i = 0; i < 4; i++) {
+        if ((game->gfx.lazy[i].state == GAME_GFX_PAGE_ALIAS) && (game->gfx.lazy[i].src == page)) {
+            _game_gfx_materialize(game, i);
+        }
+    }
+}
+
+// the content of the rows top to bottom of page is about to change, false if there are none,
+// the pixels of a lazy page are left as they are
+static bool _game_gfx_note_rows(game_t* game, int page, int top, int bottom) {
+    top = _MAX(top, 0);
+    bottom = _MIN(bottom, GAME_HEIGHT - 1);
+    if (top > bottom) {
+        return false;
+    }
+    _game_gfx_detach(game, page);
+    if (page == game->gfx.presented) {
+        // keep the displayed image, the host may still read it
+        _game_gfx_mirror_page(game, _GAME_GFX_FB, page);
+        game->gfx.presented = _GAME_GFX_FB;
+    }
+    for (int i = 0; i < 5; i++) {
+        if ((i == page) || (game->gfx.mirror[i] == page)) {
+            _game_gfx_add_rows(&game->gfx.diff[i], top, bottom);
+        }
+    }
+    return true;
+}
+
+// the rows top to bottom of page are about to be drawn into
+static void _game_gfx_mark_rows(game_t* game, int page, int top, int bottom) {
+    if (_game_gfx_note_rows(game, page, top, bottom)) {
+        _game_gfx_materialize(game, page);
+    }
+}
+
+// copy the page src into dst (a page or _GAME_GFX_FB), only the rows changed since the last copy
+static void _game_gfx_mirror_page(game_t* game, int dst, int src) {
+    if (dst == src) {
+        return;
+    }
+    game_gfx_rows_t rows = { 0, GAME_HEIGHT - 1 };
+    if (game->gfx.mirror[dst] == src) {
+        rows = game->gfx.diff[dst];
+    }
+    if (rows.top <= rows.bottom) {
+        if (dst != _GAME_GFX_FB) {
+            _game_gfx_mark_rows(game, dst, rows.top, rows.bottom);
+            _game_gfx_heat_rows(game, dst, GAME_GFX_WRITE_COPY, rows.top, rows.bottom + 1);
+        }
+        const game_hires_t* hr = game->host.hires;
+        if (hr) {
+            const size_t offset = (size_t)rows.top * hr->scale * hr->width;
+            const size_t size = (size_t)(rows.bottom - rows.top + 1) * hr->scale * hr->width;
+            memcpy(((dst == _GAME_GFX_FB) ? hr->fb : hr->fbs[dst]) + offset, hr->fbs[src] + offset, size);
+        }
+        if (game->host.packed) {
+            const int offset = rows.top * _GAME_PACKED_PITCH;
+            const int size = (rows.bottom - rows.top + 1) * _GAME_PACKED_PITCH;
+            if (dst == _GAME_GFX_FB) {
+                _game_packed_expand(game->gfx.fb + 2 * offset, _game_gfx_get_page_ptr(game, src) + offset, size);
+            } else {
+                memcpy(_game_gfx_get_page_ptr(game, dst) + offset, _game_gfx_get_page_ptr(game, src) + offset, size);
+            }
+        } else {
+            const int offset = rows.top * GAME_WIDTH;
+            const int size = (rows.bottom - rows.top + 1) * GAME_WIDTH;
+            memcpy(((dst == _GAME_GFX_FB) ? game->gfx.fb : _game_gfx_get_page_ptr(game, dst)) + offset, _game_gfx_get_page_ptr(game, src) + offset, size);
+        }
+    }
+    game->gfx.mirror[dst] = src;
+    game->gfx.diff[dst] = (game_gfx_rows_t){ GAME_HEIGHT, -1 };
+}
+
+void game_reset_dirty_rows(game_t* game) {
+    GAME_ASSERT(game && game->valid);
+    game->gfx.fb_dirty = (game_gfx_rows_t){ GAME_HEIGHT, -1 };
+}
+
+/*
+    Lazy pages: a fill or a copy of a whole page only records what the page
+    holds in gfx.lazy. The pixels are written when the page is drawn into,
+    so a page filled or copied again before is never written. Until then
+    the buffer keeps the old pixels, and the dirty rows of the page still
+    tell which of them differ from the page it mirrors. Presenting a copy
+    and the polygons copying page 0 read the pixels of the source page.
+*/
+static void _game_gfx_materialize(game_t* game, int page) {
+    const game_gfx_lazy_t lz = game->gfx.lazy[page];
+    if (lz.state == GAME_GFX_PAGE_PIXELS) {
+        return;
+    }
+    game->gfx.lazy[page].state = GAME_GFX_PAGE_PIXELS;
+    if (lz.state == GAME_GFX_PAGE_SOLID) {
+        _game_gfx_fill_page(game, page, lz.color, 0, GAME_HEIGHT);
+    } else {
+        _game_gfx_mirror_page(game, page, lz.src);
+    }
+}
+
+// dst holds the content of src from now on
+static void _game_gfx_alias_page(game_t* game, int dst, int src) {
+    const int pixels = _game_gfx_page_pixels(game, src);
+    if (pixels == dst) {
+        // dst already holds these pixels
+        return;
+    }
+    game_gfx_rows_t rows = { 0, GAME_HEIGHT - 1 };
+    if ((pixels >= 0) && (game->gfx.mirror[dst] == pixels)) {
+        rows = game->gfx.diff[dst];
+    }
+    _game_gfx_note_rows(game, dst, rows.top, rows.bottom);
+    if (pixels < 0) {
+        game->gfx.lazy[dst] = (game_gfx_lazy_t){ GAME_GFX_PAGE_SOLID, game->gfx.lazy[src].color, 0 };
+    } else {
+        game->gfx.lazy[dst] = (game_gfx_lazy_t){ GAME_GFX_PAGE_ALIAS, 0, (int8_t)pixels };
+    }
+}
+
+/*
+    True color backgrounds: an RGB bitmap is kept at its resolution in one
+    of the images of host.background and the page is cleared to color 0. The
+    bitmap follows the page through the page copies by its resource number in
+    gfx.bg_res and is dropped by a fill or an indexed bitmap. When such a page
+    is presented its pixels are composed over the image, color 0 being
+    transparent, or the image is presented as it is while nothing is drawn
+    over it. The images are decoded again from the resources when a
+    snapshot refers to bitmaps not decoded yet, see _game_gfx_bg_restore().
+*/
+static void _game_gfx_bg_reset(game_t* game) {
+    for (int i = 0; i < 5; i++) {
+        game->gfx.bg_res[i] = GAME_GFX_NO_BACKGROUND;
+        game->gfx.bg_dy[i] = 0;
+    }
+    if (game->host.background) {
+        game->host.background->frame = 0;
+    }
+}
+
+// the image decoded from the bitmap resource, 0 if there is none
+static const game_gfx_image_t* _game_gfx_bg_find(const game_t* game, uint16_t res_num) {
+    const game_gfx_background_t* bg = game->host.background;
+    if (bg && (res_num != GAME_GFX_NO_BACKGROUND)) {
+        for (int i = 0; i < GAME_GFX_MAX_BACKGROUNDS; i++) {
+            if (bg->images[i].pixels && (bg->images[i].res_num == res_num)) {
+                return &bg->images[i];
+            }
+        }
+    }
+    return 0;
+}
+
+static void _game_gfx_bg_discard(game_t* game) {
+    game_gfx_background_t* bg = game->host.background;
+    if (bg) {
+        for (int i = 0; i < GAME_GFX_MAX_BACKGROUNDS; i++) {
+            if (bg->images[i].pixels) {
+                _game_free(game, bg->images[i].pixels);
+            }
+        }
+        if (bg->composed) {
+            _game_free(game, bg->composed);
+        }
+        if (bg->row) {
+            _game_free(game, bg->row);
+        }
+        _game_free(game, bg);
+        game->host.background = 0;
+    }
+}
+
+static void _game_gfx_bg_clear(game_t* game, int page) {
+    game->gfx.bg_res[page] = GAME_GFX_NO_BACKGROUND;
+}
+
+static void _game_gfx_bg_copy(game_t* game, int dst, int src, int vscroll) {
+    game->gfx.bg_res[dst] = game->gfx.bg_res[src];
+    game->gfx.bg_dy[dst] = (int16_t)(game->gfx.bg_dy[src] + vscroll);
+}
+
+/*
+    Scene stream: with game_desc_t.scene the fills, copies, polygons,
+    characters, bitmaps and RGB backgrounds of the pages are also written
+    into host.scene, as described at game_scene_op_t, and handed to the
+    host each time a page is presented. The records are written at the draw
+    calls, before the display list or the rasterizer, so the stream is the
+    same in all the drawing modes. With no_raster the pages only get the
+    fills, copies and bitmaps, so they can't be saved by a snapshot.
+*/
+static void _game_scene_init(game_t* game, const game_scene_desc_t* desc) {
+    game_scene_t* sc = (game_scene_t*)_game_malloc(game, sizeof(game_scene_t));
+    memset(sc, 0, sizeof(game_scene_t));
+    sc->desc = *desc;
+    sc->capacity = 0x10000;
+    sc->data = (uint8_t*)_game_malloc(game, sc->capacity);
+    game->host.scene = sc;
+}
+
+static void _game_scene_discard(game_t* game) {
+    game_scene_t* sc = game->host.scene;
+    if (sc) {
+        _game_free(game, sc->data);
+        _game_free(game, sc);
+        game->host.scene = 0;
+    }
+}
+
+static uint8_t* _game_scene_put16(uint8_t* p, int v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t* _game_scene_put32(uint8_t* p, uint32_t v) {
+    p = _game_scene_put16(p, (int)(v & 0xFFFF));
+    return _game_scene_put16(p, (int)(v >> 16));
+}
+
+// append a record of size bytes after the opcode, returns where to write them
+static uint8_t* _game_scene_record(game_t* game, game_scene_op_t op, size_t size) {
+    game_scene_t* sc = game->host.scene;
+    // room for the begin record of the frame, the opcode and the fields
+    const size_t needed = sc->size + 7 + 1 + size;
+    if (needed > sc->capacity) {
+        // a bitmap or a busy frame, the buffer only grows
+        size_t capacity = sc->capacity * 2;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        uint8_t* data = (uint8_t*)_game_malloc(game, capacity);
+        memcpy(data, sc->data, sc->size);
+        _game_free(game, sc->data);
+        sc->data = data;
+        sc->capacity = capacity;
+    }
+    uint8_t* p = sc->data + sc->size;
+    if (sc->size == 0) {
+        *p++ = GAME_SCENE_OP_BEGIN;
+        p = _game_scene_put16(p, GAME_SCENE_VERSION);
+        p = _game_scene_put32(p, sc->frame);
+    }
+    *p++ = (uint8_t)op;
+    sc->size = (size_t)(p - sc->data) + size;
+    return p;
+}
+
+static void _game_scene_fill(game_t* game, int page, uint8_t color) {
+    if (game->host.scene) {
+        uint8_t* p = _game_scene_record(game, GAME_SCENE_OP_FILL, 2);
+        p[0] = (uint8_t)page;
+        p[1] = color;
+    }
+}
+
+static void _game_scene_copy(game_t* game, int dst, int src, int vscroll) {
+    if (game->host.scene) {
+        uint8_t* p = _game_scene_record(game, GAME_SCENE_OP_COPY, 4);
+        p[0] = (uint8_t)dst;
+        p[1] = (uint8_t)src;
+        _game_scene_put16(p + 2, vscroll);
+    }
+}
+
+static game_scene_blend_t _game_scene_blend(uint8_t color) {
+    switch (color) {
+    case _GFX_COL_ALPHA:
+        return GAME_SCENE_BLEND_ALPHA;
+    case _GFX_COL_PAGE:
+        return GAME_SCENE_BLEND_PAGE;
+    default:
+        return GAME_SCENE_BLEND_SOLID;
+    }
+}
+
+static void _game_scene_point(game_t* game, int page, uint8_t color, const _game_point_t* pt) {
+    uint8_t* p = _game_scene_record(game, GAME_SCENE_OP_POINT, 7);
+    p[0] = (uint8_t)page;
+    p[1] = (uint8_t)_game_scene_blend(color);
+    p[2] = color;
+    p = _game_scene_put16(p + 3, pt->x);
+    _game_scene_put16(p, pt->y);
+}
+
+static void _game_scene_polygon(game_t* game, int page, uint8_t color, const _game_quad_strip_t* qs) {
+    uint8_t* p = _game_scene_record(game, GAME_SCENE_OP_POLYGON, 4 + 4 * (size_t)qs->num_vertices);
+    p[0] = (uint8_t)page;
+    p[1] = (uint8_t)_game_scene_blend(color);
+    p[2] = color;
+    p[3] = (uint8_t)qs->num_vertices;
+    p += 4;
+    for (int i = 0; i < qs->num_vertices; i++) {
+        p = _game_scene_put16(p, qs->vertices[i].x);
+        p = _game_scene_put16(p, qs->vertices[i].y);
+    }
+}
+
+static void _game_scene_char(game_t* game, int page, uint8_t color, char c, const _game_point_t* pt) {
+    // the same characters as _game_gfx_draw_char()
+    if (game->host.scene && (uint16_t)pt->x <= GAME_WIDTH - 8 && (uint16_t)pt->y <= GAME_HEIGHT - 8) {
+        uint8_t* p = _game_scene_record(game, GAME_SCENE_OP_CHAR, 14);
+        p[0] = (uint8_t)page;
+        p[1] = color;
+        p = _game_scene_put16(p + 2, pt->x);
+        p = _game_scene_put16(p, pt->y);
+        memcpy(p, _font + ((uint8_t)c - 0x20) * 8, 8);
+    }
+}
+
+// all the pixels of the page, which holds them (not lazy)
+static void _game_scene_bitmap(game_t* game, int page) {
+    if (game->host.scene) {
+        uint8_t* p = _game_scene_record(game, GAME_SCENE_OP_BITMAP, 1 + GAME_WIDTH * GAME_HEIGHT / 2);
+        p[0] = (uint8_t)page;
+        if (game->host.packed) {
+            memcpy(p + 1, _game_gfx_get_page_ptr(game, page), GAME_WIDTH * GAME_HEIGHT / 2);
+        } else {
+            _game_packed_pack(p + 1, _game_gfx_get_page_ptr(game, page), GAME_WIDTH * GAME_HEIGHT / 2);
+        }
+    }
+}
+
+// the RGB bitmap behind the page, see _game_gfx_draw_background()
+static void _game_scene_background(game_t* game, int page) {
+    const game_gfx_image_t* img = game->host.scene ? _game_gfx_bg_find(game, game->gfx.bg_res[page]) : 0;
+    if (img) {
+        const size_t count = (size_t)img->width * img->height;
+        uint8_t* p = _game_scene_record(game, GAME_SCENE_OP_BACKGROUND, 9 + 4 * count);
+        *p++ = (uint8_t)page;
+        p = _game_scene_put16(p, img->res_num);
+        p = _game_scene_put16(p, game->gfx.bg_dy[page]);
+        p = _game_scene_put16(p, img->width);
+        p = _game_scene_put16(p, img->height);
+        for (size_t i = 0; i < count; i++) {
+            p = _game_scene_put32(p, img->pixels[i]);
+        }
+    }
+}
+
+// the pages are replaced by a snapshot, the frame restarts with their pixels
+static void _game_scene_restart(game_t* game) {
+    if (game->host.scene) {
+        game->host.scene->size = 0;
+        for (int i = 0; i < 4; i++) {
+            _game_scene_bitmap(game, i);
+            _game_scene_background(game, i);
+        }
+    }
+}
+
+// the polygons and the text are only recorded, the pages miss them
+static bool _game_scene_no_raster(const game_t* game) {
+    return game->host.scene && game->host.scene->desc.no_raster;
+}
+
+// the page is presented, hand the frame to the host and start the next one
+static void _game_scene_frame(game_t* game, int page) {
+    game_scene_t* sc = game->host.scene;
+    if (sc) {
+        uint8_t* p = _game_scene_record(game, GAME_SCENE_OP_FRAME, 1 + 16 * 4);
+        *p++ = (uint8_t)page;
+        for (int i = 0; i < 16; i++) {
+            p = _game_scene_put32(p, game->gfx.palette[i]);
+        }
+        if (sc->desc.func) {
+            sc->desc.func(sc->data, sc->size, sc->desc.user_data);
+        }
+        sc->size = 0;
+        sc->frame++;
+    }
+}
+
+static void _game_gfx_clear_buffer(game_t* game, int num, uint8_t color) {
+    _game_scene_fill(game, num, color);
+    _game_gfx_bg_clear(game, num);
+    _game_gfx_note_rows(game, num, 0, GAME_HEIGHT - 1);
+    if (game->host.use_display_list) {
+        // the fill hides everything recorded before, and the old pixels
+        const uint8_t draw_page = game->gfx.draw_page;
+        const _game_point_t pt = { 0, 0 };
+        game->gfx.lazy[num].state = GAME_GFX_PAGE_PIXELS;
+        _game_gfx_reset_list(game, num);
+        _game_gfx_record(game, num, GAME_GFX_CMD_FILL, color, &pt, 0);
+        _game_gfx_set_work_page(game, draw_page);
+        return;
+    }
+    game->gfx.lazy[num] = (game_gfx_lazy_t){ GAME_GFX_PAGE_SOLID, color, 0 };
+}
+
+static void _game_gfx_copy_buffer(game_t* game, int dst, int src, int vscroll) {
+    if (game->host.use_display_list) {
+        _game_gfx_resolve(game, src);
+        if (vscroll == 0) {
+            _game_gfx_reset_list(game, dst);
+        } else {
+            _game_gfx_resolve(game, dst);
+        }
+        _game_gfx_begin_write(game, dst);
+    }
+    if (vscroll >= -199 && vscroll <= 199) {
+        _game_gfx_bg_copy(game, dst, src, vscroll);
+        _game_scene_copy(game, dst, src, vscroll);
+    }
+    if (vscroll == 0) {
+        _game_gfx_alias_page(game, dst, src);
+        return;
+    }
+    if (vscroll < -199 || vscroll > 199) {
+        return;
+    }
+    // the rows scrolled out keep the pixels of dst, only the full copies are lazy
+    _game_gfx_mark_rows(game, dst, vscroll, GAME_HEIGHT - 1 + vscroll);
+    const int pixels = _game_gfx_page_pixels(game, src);
+    if (pixels < 0) {
+        _game_gfx_fill_page(game, dst, game->gfx.lazy[src].color, _MAX(vscroll, 0), _MIN(GAME_HEIGHT + vscroll, GAME_HEIGHT));
+        return;
+    }
+    _game_gfx_heat_rows(game, dst, GAME_GFX_WRITE_COPY, _MAX(vscroll, 0), _MIN(GAME_HEIGHT + vscroll, GAME_HEIGHT));
+    const game_hires_t* hr = game->host.hires;
+    if (hr) {
+        const int dy = vscroll * hr->scale;
+        const size_t page_size = (size_t)hr->width * hr->height;
+        if (dy < 0) {
+            memcpy(hr->fbs[dst], hr->fbs[pixels] - dy * hr->width, page_size + dy * hr->width);
+        } else {
+            memcpy(hr->fbs[dst] + dy * hr->width, hr->fbs[pixels], page_size - dy * hr->width);
+        }
+    }
+    const int dy = vscroll;
+    const int pitch = game->host.packed ? _GAME_PACKED_PITCH : GAME_WIDTH;
+    if (dy < 0) {
+        memcpy(_game_gfx_get_page_ptr(game, dst), _game_gfx_get_page_ptr(game, pixels) - dy * pitch, (GAME_HEIGHT + dy) * pitch);
+    } else {
+        memcpy(_game_gfx_get_page_ptr(game, dst) + dy * pitch, _game_gfx_get_page_ptr(game, pixels), (GAME_HEIGHT - dy) * pitch);
+    }
+}
+
+// the pixels shown by the host for the presented page, at the hires scale if any
+static uint8_t* _game_gfx_presented_pixels(game_t* game, int* width, int* height) {
+    const game_hires_t* hr = game->host.hires;
+    const int page = game->gfx.presented;
+    *width = hr ? hr->width : GAME_WIDTH;
+    *height = hr ? hr->height : GAME_HEIGHT;
+    return (page == _GAME_GFX_FB) ? (hr ? hr->fb : game->gfx.fb) : (hr ? hr->fbs[page] : game->gfx.fbs[page].buffer);
+}
+
+static void _game_gfx_bg_present(game_t* game, int page);
+
+static void _game_gfx_draw_buffer(game_t* game, int num) {
+    const int page = num;
+    if (game->host.use_display_list) {
+        _game_gfx_resolve(game, num);
+    }
+    // a copy not written yet is presented from its source page
+    if (game->gfx.lazy[num].state == GAME_GFX_PAGE_SOLID) {
+        _game_gfx_materialize(game, num);
+    }
+    num = _game_gfx_page_pixels(game, num);
+    if (game->host.packed) {
+        // packed pages are expanded into the frame buffer, only the rows changed since the last expansion
+        game_gfx_rows_t rows = { 0, GAME_HEIGHT - 1 };
+        if (game->gfx.mirror[_GAME_GFX_FB] == num) {
+            rows = game->gfx.diff[_GAME_GFX_FB];
+        }
+        _game_gfx_mirror_page(game, _GAME_GFX_FB, num);
+        _game_gfx_add_rows(&game->gfx.fb_dirty, rows.top, rows.bottom);
+    } else if (game->gfx.presented != num) {
+        // the page is presented in place, only the rows which differ from the displayed image are dirty
+        game_gfx_rows_t rows = { 0, GAME_HEIGHT - 1 };
+        if ((game->gfx.presented == _GAME_GFX_FB) && (game->gfx.mirror[_GAME_GFX_FB] == num)) {
+            rows = game->gfx.diff[_GAME_GFX_FB];
+        }
+        _game_gfx_add_rows(&game->gfx.fb_dirty, rows.top, rows.bottom);
+        game->gfx.presented = num;
+    }
+    _game_gfx_bg_present(game, page);
+    _game_scene_frame(game, page);
+    _game_gfx_heat_flip(game);
+}
+
+static void _game_gfx_draw_string_char(game_t* game, int buffer, uint8_t color, char c, const _game_point_t *pt) {
+    _game_scene_char(game, buffer, color, c, pt);
+    if (_game_scene_no_raster(game)) {
+        return;
+    }
+    _game_gfx_mark_rows(game, buffer, pt->y, pt->y + 7);
+    if (game->host.use_display_list) {
+        game_gfx_cmd_t* cmd = _game_gfx_record(game, buffer, GAME_GFX_CMD_CHAR, color, pt, 0);
+        cmd->data = (uint8_t)c;
+        cmd->top = pt->y;
+        cmd->bottom = pt->y + 7;
+        return;
+    }
+    _game_gfx_set_work_page(game, buffer);
+    _game_gfx_draw_char(game, c, pt->x, pt->y, color, 0, GAME_HEIGHT);
+}
+
+// 0x4000 / delta for the edge steps, zero for larger deltas
+#define _GAME_RECIPROCAL_SIZE (0x4001)
+static uint16_t _game_reciprocal[_GAME_RECIPROCAL_SIZE];
+
+static void _game_gfx_init_reciprocal(void) {
+    if (_game_reciprocal[1] == 0) {
+        for (int i = 1; i < _GAME_RECIPROCAL_SIZE; i++) {
+            _game_reciprocal[i] = (uint16_t)(0x4000 / i);
+        }
+    }
+}
+
+static uint32_t _calc_step(const _game_point_t* p1, const _game_point_t* p2, uint16_t* dy) {
+    *dy = p2->y - p1->y;
+    const uint16_t delta = (*dy <= 1) ? 1 : *dy;
+    const uint32_t recip = (delta < _GAME_RECIPROCAL_SIZE) ? _game_reciprocal[delta] : 0;
+    return ((uint32_t)(p2->x - p1->x) * recip) << 2;
+}
+
+// exact 16.16 step for the high resolution pages, where the deltas are too large for the table
+static uint32_t _calc_step_hires(const _game_point_t* p1, const _game_point_t* p2, uint16_t* dy) {
+    *dy = p2->y - p1->y;
+    const int32_t delta = (*dy <= 1) ? 1 : *dy;
+    return (uint32_t)(int32_t)(((int64_t)(p2->x - p1->x) * 65536) / delta);
+}
+
+/*
+    Span kernels: fill with a color, OR with 8 (transparency) and copy from
+    page 0. Spans shorter than _GAME_SPAN_SIMD_MIN are handled inline with
+    two overlapping stores of 8, 4, 2 or 1 bytes, so no byte outside the
+    span is touched. Longer spans go through the kernels selected once by
+    _game_gfx_init_spans(), which finish with one overlapping vector store
+    at the end of the span instead of a scalar tail. All three operations
+    give the same result when a byte is written twice. The OR sets bits in
+    each byte, 0x08 for one pixel per byte and 0x88 for packed pages.
+*/
+#define _GAME_SPAN_SIMD_MIN (16)
+
+typedef struct {
+    void (*fill)(uint8_t* dst, uint8_t color, int w);
+    void (*or8)(uint8_t* dst, uint8_t bits, int w);
+    void (*copy)(uint8_t* dst, const uint8_t* src, int w);
+} _game_span_kernels_t;
+
+static void _game_span_fill_scalar(uint8_t* dst, uint8_t color, int w) {
+    memset(dst, color, (size_t)w);
+}
+
+static void _game_span_or8_scalar(uint8_t* dst, uint8_t bits, int w) {
+    const uint64_t mask = 0x0101010101010101ULL * bits;
+    uint64_t v;
+    int i = 0;
+    for (; i + 8 <= w; i += 8) {
+        memcpy(&v, dst + i, 8);
+        v |= mask;
+        memcpy(dst + i, &v, 8);
+    }
+    if (i < w) {
+        memcpy(&v, dst + w - 8, 8);
+        v |= mask;
+        memcpy(dst + w - 8, &v, 8);
+    }
+}
+
+static void _game_span_copy_scalar(uint8_t* dst, const uint8_t* src, int w) {
+    memcpy(dst, src, (size_t)w);
+}
+
+#if defined(_GAME_SIMD_SSE2)
+static void _game_span_fill_sse2(uint8_t* dst, uint8_t color, int w) {
+    const __m128i v = _mm_set1_epi8((char)color);
+    int i = 0;
+    for (; i + 16 <= w; i += 16) {
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+    }
+    if (i < w) {
+        _mm_storeu_si128((__m128i*)(dst + w - 16), v);
+    }
+}
+
+static void _game_span_or8_sse2(uint8_t* dst, uint8_t bits, int w) {
+    const __m128i mask = _mm_set1_epi8((char)bits);
+    int i = 0;
+    for (; i + 16 <= w; i += 16) {
+        __m128i* p = (__m128i*)(dst + i);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_loadu_si128(p), mask));
+    }
+    if (i < w) {
+        __m128i* p = (__m128i*)(dst + w - 16);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_loadu_si128(p), mask));
+    }
+}
+
+static void _game_span_copy_sse2(uint8_t* dst, const uint8_t* src, int w) {
+    int i = 0;
+    for (; i + 16 <= w; i += 16) {
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_loadu_si128((const __m128i*)(src + i)));
+    }
+    if (i < w) {
+        _mm_storeu_si128((__m128i*)(dst + w - 16), _mm_loadu_si128((const __m128i*)(src + w - 16)));
+    }
+}
+#endif
+
+#if defined(_GAME_SIMD_AVX2)
+static bool _game_cpu_has_avx2(void) {
+    #if defined(_MSC_VER) && !defined(__clang__)
+        int regs[4];
+        __cpuid(regs, 0);
+        if (regs[0] < 7) {
+            return false;
+        }
+        __cpuid(regs, 1);
+        const bool osxsave = (regs[2] & (1 << 27)) != 0;
+        if (!osxsave || ((_xgetbv(0) & 6) != 6)) {
+            return false;
+        }
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+    #else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    #endif
+}
+
+_GAME_TARGET_AVX2 static void _game_span_fill_avx2(uint8_t* dst, uint8_t color, int w) {
+    if (w < 32) {
+        const __m128i v = _mm_set1_epi8((char)color);
+        _mm_storeu_si128((__m128i*)dst, v);
+        _mm_storeu_si128((__m128i*)(dst + w - 16), v);
+        return;
+    }
+    const __m256i v = _mm256_set1_epi8((char)color);
+    int i = 0;
+    for (; i + 32 <= w; i += 32) {
+        _mm256_storeu_si256((__m256i*)(dst + i), v);
+    }
+    if (i < w) {
+        _mm256_storeu_si256((__m256i*)(dst + w - 32), v);
+    }
+}
+
+_GAME_TARGET_AVX2 static void _game_span_or8_avx2(uint8_t* dst, uint8_t bits, int w) {
+    if (w < 32) {
+        const __m128i mask = _mm_set1_epi8((char)bits);
+        __m128i* p = (__m128i*)dst;
+        _mm_storeu_si128(p, _mm_or_si128(_mm_loadu_si128(p), mask));
+        p = (__m128i*)(dst + w - 16);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_loadu_si128(p), mask));
+        return;
+    }
+    const __m256i mask = _mm256_set1_epi8((char)bits);
+    int i = 0;
+    for (; i + 32 <= w; i += 32) {
+        __m256i* p = (__m256i*)(dst + i);
+        _mm256_storeu_si256(p, _mm256_or_si256(_mm256_loadu_si256(p), mask));
+    }
+    if (i < w) {
+        __m256i* p = (__m256i*)(dst + w - 32);
+        _mm256_storeu_si256(p, _mm256_or_si256(_mm256_loadu_si256(p), mask));
+    }
+}
+
+_GAME_TARGET_AVX2 static void _game_span_copy_avx2(uint8_t* dst, const uint8_t* src, int w) {
+    if (w < 32) {
+        _mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+        _mm_storeu_si128((__m128i*)(dst + w - 16), _mm_loadu_si128((const __m128i*)(src + w - 16)));
+        return;
+    }
+    int i = 0;
+    for (; i + 32 <= w; i += 32) {
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_loadu_si256((const __m256i*)(src + i)));
+    }
+    if (i < w) {
+        _mm256_storeu_si256((__m256i*)(dst + w - 32), _mm256_loadu_si256((const __m256i*)(src + w - 32)));
+    }
+}
+#endif
+
+#if defined(_GAME_SIMD_NEON)
+static void _game_span_fill_neon(uint8_t* dst, uint8_t color, int w) {
+    const uint8x16_t v = vdupq_n_u8(color);
+    int i = 0;
+    for (; i + 16 <= w; i += 16) {
+        vst1q_u8(dst + i, v);
+    }
+    if (i < w) {
+        vst1q_u8(dst + w - 16, v);
+    }
+}
+
+static void _game_span_or8_neon(uint8_t* dst, uint8_t bits, int w) {
+    const uint8x16_t mask = vdupq_n_u8(bits);
+    int i = 0;
+    for (; i + 16 <= w; i += 16) {
+        vst1q_u8(dst + i, vorrq_u8(vld1q_u8(dst + i), mask));
+    }
+    if (i < w) {
+        vst1q_u8(dst + w - 16, vorrq_u8(vld1q_u8(dst + w - 16), mask));
+    }
+}
+
+static void _game_span_copy_neon(uint8_t* dst, const uint8_t* src, int w) {
+    int i = 0;
+    for (; i + 16 <= w; i += 16) {
+        vst1q_u8(dst + i, vld1q_u8(src + i));
+    }
+    if (i < w) {
+        vst1q_u8(dst + w - 16, vld1q_u8(src + w - 16));
+    }
+}
+#endif
+
+static _game_span_kernels_t _game_spans = {
+    _game_span_fill_scalar, _game_span_or8_scalar, _game_span_copy_scalar
+};
+
+static void _game_gfx_init_spans(void) {
+    #if defined(_GAME_SIMD_AVX2)
+        if (_game_cpu_has_avx2()) {
+            _game_spans = (_game_span_kernels_t){ _game_span_fill_avx2, _game_span_or8_avx2, _game_span_copy_avx2 };
+            return;
+        }
+    #endif
+    #if defined(_GAME_SIMD_SSE2)
+        _game_spans = (_game_span_kernels_t){ _game_span_fill_sse2, _game_span_or8_sse2, _game_span_copy_sse2 };
+    #elif defined(_GAME_SIMD_NEON)
+        _game_spans = (_game_span_kernels_t){ _game_span_fill_neon, _game_span_or8_neon, _game_span_copy_neon };
+    #endif
+}
+
+static inline void _game_span_fill(uint8_t* dst, uint8_t color, int w) {
+    if (w >= _GAME_SPAN_SIMD_MIN) {
+        _game_spans.fill(dst, color, w);
+    } else if (w >= 8) {
+        const uint64_t v = 0x0101010101010101ULL * color;
+        memcpy(dst, &v, 8);
+        memcpy(dst + w - 8, &v, 8);
+    } else if (w >= 4) {
+        const uint32_t v = 0x01010101U * color;
+        memcpy(dst, &v, 4);
+        memcpy(dst + w - 4, &v, 4);
+    } else if (w >= 2) {
+        const uint16_t v = (uint16_t)(0x0101U * color);
+        memcpy(dst, &v, 2);
+        memcpy(dst + w - 2, &v, 2);
+    } else if (w == 1) {
+        dst[0] = color;
+    }
+}
+
+static inline void _game_span_or8(uint8_t* dst, uint8_t bits, int w) {
+    if (w >= _GAME_SPAN_SIMD_MIN) {
+        _game_spans.or8(dst, bits, w);
+    } else if (w >= 8) {
+        const uint64_t mask = 0x0101010101010101ULL * bits;
+        uint64_t v;
+        memcpy(&v, dst, 8); v |= mask; memcpy(dst, &v, 8);
+        memcpy(&v, dst + w - 8, 8); v |= mask; memcpy(dst + w - 8, &v, 8);
+    } else if (w >= 4) {
+        const uint32_t mask = 0x01010101U * bits;
+        uint32_t v;
+        memcpy(&v, dst, 4); v |= mask; memcpy(dst, &v, 4);
+        memcpy(&v, dst + w - 4, 4); v |= mask; memcpy(dst + w - 4, &v, 4);
+    } else {
+        for (int i = 0; i < w; i++) {
+            dst[i] |= bits;
+        }
+    }
+}
+
+static inline void _game_span_copy(uint8_t* dst, const uint8_t* src, int w) {
+    if (w >= _GAME_SPAN_SIMD_MIN) {
+        _game_spans.copy(dst, src, w);
+    } else if (w >= 8) {
+        memcpy(dst, src, 8);
+        memcpy(dst + w - 8, src + w - 8, 8);
+    } else if (w >= 4) {
+        memcpy(dst, src, 4);
+        memcpy(dst + w - 4, src + w - 4, 4);
+    } else {
+        for (int i = 0; i < w; i++) {
+            dst[i] = src[i];
+        }
+    }
+}
+
+/*
+    Pixel conversion: the 16 colors of a palette are converted once to the
+    destination format and split in byte planes, the SIMD kernels then look
+    up 16 pixels at once in each plane (SSSE3 on the CPUs with AVX2, TBL on
+    NEON) and interleave the planes into the destination pixels.
+*/
+typedef struct {
+    int         bpp;            // bytes per destination pixel, 2 or 4
+    uint32_t    colors[16];     // in the destination format
+    uint8_t     planes[4][16];  // byte i of each color in memory order
+} _game_convert_pal_t;
+
+typedef void (*_game_convert_func_t)(uint8_t* dst, const uint8_t* src, int num, const _game_convert_pal_t* cp);
+
+static void _game_convert_scalar(uint8_t* dst, const uint8_t* src, int num, const _game_convert_pal_t* cp) {
+    if (cp->bpp == 4) {
+        for (int i = 0; i < num; i++) {
+            memcpy(dst + 4 * i, &cp->colors[src[i] & 0xF], 4);
+        }
+    } else {
+        for (int i = 0; i < num; i++) {
+            const uint16_t c = (uint16_t)cp->colors[src[i] & 0xF];
+            memcpy(dst + 2 * i, &c, 2);
+        }
+    }
+}
+
+#if defined(_GAME_SIMD_AVX2)
+_GAME_TARGET_AVX2 static void _game_convert_ssse3(uint8_t* dst, const uint8_t* src, int num, const _game_convert_pal_t* cp) {
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i p0 = _mm_loadu_si128((const __m128i*)cp->planes[0]);
+    const __m128i p1 = _mm_loadu_si128((const __m128i*)cp->planes[1]);
+    int i = 0;
+    if (cp->bpp == 4) {
+        const __m128i p2 = _mm_loadu_si128((const __m128i*)cp->planes[2]);
+        const __m128i p3 = _mm_loadu_si128((const __m128i*)cp->planes[3]);
+        for (; i + 16 <= num; i += 16) {
+            const __m128i idx = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i)), nibble);
+            const __m128i c0 = _mm_shuffle_epi8(p0, idx);
+            const __m128i c1 = _mm_shuffle_epi8(p1, idx);
+            const __m128i c2 = _mm_shuffle_epi8(p2, idx);
+            const __m128i c3 = _mm_shuffle_epi8(p3, idx);
+            const __m128i lo01 = _mm_unpacklo_epi8(c0, c1);
+            const __m128i hi01 = _mm_unpackhi_epi8(c0, c1);
+            const __m128i lo23 = _mm_unpacklo_epi8(c2, c3);
+            const __m128i hi23 = _mm_unpackhi_epi8(c2, c3);
+            __m128i* d = (__m128i*)(dst + 4 * i);
+            _mm_storeu_si128(d, _mm_unpacklo_epi16(lo01, lo23));
+            _mm_storeu_si128(d + 1, _mm_unpackhi_epi16(lo01, lo23));
+            _mm_storeu_si128(d + 2, _mm_unpacklo_epi16(hi01, hi23));
+            _mm_storeu_si128(d + 3, _mm_unpackhi_epi16(hi01, hi23));
+        }
+    } else {
+        for (; i + 16 <= num; i += 16) {
+            const __m128i idx = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i)), nibble);
+            const __m128i c0 = _mm_shuffle_epi8(p0, idx);
+            const __m128i c1 = _mm_shuffle_epi8(p1, idx);
+            __m128i* d = (__m128i*)(dst + 2 * i);
+            _mm_storeu_si128(d, _mm_unpacklo_epi8(c0, c1));
+            _mm_storeu_si128(d + 1, _mm_unpackhi_epi8(c0, c1));
+        }
+    }
+    _game_convert_scalar(dst + i * cp->bpp, src + i, num - i, cp);
+}
+#endif
+
+#if defined(_GAME_SIMD_NEON)
+static inline uint8x16_t _game_lookup_neon(uint8x16_t table, uint8x16_t idx) {
+    #if defined(__aarch64__) || defined(_M_ARM64)
+        return vqtbl1q_u8(table, idx);
+    #else
+        const uint8x8x2_t t = { { vget_low_u8(table), vget_high_u8(table) } };
+        return vcombine_u8(vtbl2_u8(t, vget_low_u8(idx)), vtbl2_u8(t, vget_high_u8(idx)));
+    #endif
+}
+
+static void _game_convert_neon(uint8_t* dst, const uint8_t* src, int num, const _game_convert_pal_t* cp) {
+    const uint8x16_t nibble = vdupq_n_u8(0x0F);
+    const uint8x16_t p0 = vld1q_u8(cp->planes[0]);
+    const uint8x16_t p1 = vld1q_u8(cp->planes[1]);
+    int i = 0;
+    if (cp->bpp == 4) {
+        const uint8x16_t p2 = vld1q_u8(cp->planes[2]);
+        const uint8x16_t p3 = vld1q_u8(cp->planes[3]);
+        for (; i + 16 <= num; i += 16) {
+            const uint8x16_t idx = vandq_u8(vld1q_u8(src + i), nibble);
+            const uint8x16x4_t c = { { _game_lookup_neon(p0, idx), _game_lookup_neon(p1, idx), _game_lookup_neon(p2, idx), _game_lookup_neon(p3, idx) } };
+            vst4q_u8(dst + 4 * i, c);
+        }
+    } else {
+        for (; i + 16 <= num; i += 16) {
+            const uint8x16_t idx = vandq_u8(vld1q_u8(src + i), nibble);
+            const uint8x16x2_t c = { { _game_lookup_neon(p0, idx), _game_lookup_neon(p1, idx) } };
+            vst2q_u8(dst + 2 * i, c);
+        }
+    }
+    _game_convert_scalar(dst + i * cp->bpp, src + i, num - i, cp);
+}
+#endif
+
+static _game_convert_func_t _game_convert;
+
+static void _game_init_convert(void) {
+    if (!_game_convert) {
+        _game_convert = _game_convert_scalar;
+        #if defined(_GAME_SIMD_AVX2)
+            if (_game_cpu_has_avx2()) {
+                _game_convert = _game_convert_ssse3;
+            }
+        #elif defined(_GAME_SIMD_NEON)
+            _game_convert = _game_convert_neon;
+        #endif
+    }
+}
+
+static void _game_convert_prepare(_game_convert_pal_t* cp, const uint32_t palette[16], game_pixel_format_t fmt) {
+    cp->bpp = (fmt == GAME_PIXEL_RGBA32) ? 4 : 2;
+    for (int i = 0; i < 16; i++) {
+        const uint32_t c = palette[i];
+        const uint32_t r = c & 0xFF, g = (c >> 8) & 0xFF, b = (c >> 16) & 0xFF;
+        uint8_t bytes[4];
+        switch (fmt) {
+        case GAME_PIXEL_RGB565: {
+            const uint16_t v = (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+            cp->colors[i] = v;
+            memcpy(bytes, &v, 2);
+            break;
+        }
+        case GAME_PIXEL_RGB555: {
+            const uint16_t v = (uint16_t)(((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3));
+            cp->colors[i] = v;
+            memcpy(bytes, &v, 2);
+            break;
+        }
+        default:
+            cp->colors[i] = c;
+            memcpy(bytes, &c, 4);
+            break;
+        }
+        for (int j = 0; j < cp->bpp; j++) {
+            cp->planes[j][i] = bytes[j];
+        }
+    }
+}
+
+void game_convert_pixels(void* dst, const uint8_t* src, int num, const uint32_t palette[16], game_pixel_format_t fmt) {
+    GAME_ASSERT(dst && src && palette && (num >= 0));
+    _game_init_convert();
+    _game_convert_pal_t cp;
+    _game_convert_prepare(&cp, palette, fmt);
+    _game_convert((uint8_t*)dst, src, num, &cp);
+}
+
+// the pixels of dst with a zero alpha are replaced by the ones of bg
+static void _game_compose_row(uint32_t* dst, const uint32_t* bg, int n) {
+    int i = 0;
+    #if defined(_GAME_SIMD_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 4 <= n; i += 4) {
+            const __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+            const __m128i b = _mm_loadu_si128((const __m128i*)(bg + i));
+            const __m128i m = _mm_cmpeq_epi32(_mm_srli_epi32(a, 24), zero);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_and_si128(m, b), _mm_andnot_si128(m, a)));
+        }
+    #elif defined(_GAME_SIMD_NEON)
+        for (; i + 4 <= n; i += 4) {
+            const uint32x4_t a = vld1q_u32(dst + i);
+            const uint32x4_t m = vceqq_u32(vshrq_n_u32(a, 24), vdupq_n_u32(0));
+            vst1q_u32(dst + i, vbslq_u32(m, vld1q_u32(bg + i), a));
+        }
+    #endif
+    for (; i < n; i++) {
+        if ((dst[i] >> 24) == 0) {
+            dst[i] = bg[i];
+        }
+    }
+}
+
+static bool _game_is_zero(const uint8_t* p, size_t n) {
+    uint64_t acc = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t v;
+        memcpy(&v, p + i, 8);
+        acc |= v;
+    }
+    for (; i < n; i++) {
+        acc |= p[i];
+    }
+    return acc == 0;
+}
+
+// page is the presented page, or _GAME_GFX_FB to compose the presented frame again
+static void _game_gfx_bg_present(game_t* game, int page) {
+    game->gfx.bg_res[_GAME_GFX_FB] = game->gfx.bg_res[page];
+    game->gfx.bg_dy[_GAME_GFX_FB] = game->gfx.bg_dy[page];
+    game_gfx_background_t* bg = game->host.background;
+    if (!bg) {
+        return;
+    }
+    bg->frame = 0;
+    const game_gfx_image_t* img = _game_gfx_bg_find(game, game->gfx.bg_res[page]);
+    if (!img) {
+        return;
+    }
+    const int w = img->width;
+    const int h = img->height;
+    int pw, ph;
+    const uint8_t* pixels = _game_gfx_presented_pixels(game, &pw, &ph);
+    const int dy = game->gfx.bg_dy[page] * h / GAME_HEIGHT;
+    bg->frame_width = w;
+    bg->frame_height = h;
+    if ((dy == 0) && _game_is_zero(pixels, (size_t)pw * ph)) {
+        // nothing drawn over the image, no need to copy it
+        bg->frame = img->pixels;
+        return;
+    }
+    if (bg->composed_size < (size_t)w * h) {
+        if (bg->composed) {
+            _game_free(game, bg->composed);
+        }
+        bg->composed_size = (size_t)w * h;
+        bg->composed = (uint32_t*)_game_malloc(game, bg->composed_size * sizeof(uint32_t));
+    }
+    if (bg->row_size < (size_t)w) {
+        if (bg->row) {
+            _game_free(game, bg->row);
+        }
+        bg->row_size = (size_t)w;
+        bg->row = (uint8_t*)_game_malloc(game, bg->row_size * (1 + sizeof(uint16_t)));
+        bg->xmap = (uint16_t*)(bg->row + bg->row_size);
+    }
+    for (int x = 0; x < w; x++) {
+        bg->xmap[x] = (uint16_t)(x * pw / w);
+    }
+    // color 0 gets a zero alpha, the composition replaces it by the image
+    uint32_t palette[16];
+    memcpy(palette, game->gfx.palette, sizeof(palette));
+    palette[0] &= 0x00FFFFFF;
+    _game_init_convert();
+    _game_convert_pal_t cp;
+    _game_convert_prepare(&cp, palette, GAME_PIXEL_RGBA32);
+    for (int y = 0; y < h; y++) {
+        const uint8_t* src = pixels + (size_t)(y * ph / h) * pw;
+        if (pw != w) {
+            for (int x = 0; x < w; x++) {
+                bg->row[x] = src[bg->xmap[x]];
+            }
+            src = bg->row;
+        }
+        uint32_t* dst = bg->composed + (size_t)y * w;
+        _game_convert((uint8_t*)dst, src, w, &cp);
+        const int iy = y - dy;
+        if ((iy >= 0) && (iy < h)) {
+            _game_compose_row(dst, img->pixels + (size_t)iy * w, w);
+        } else {
+            // scrolled out of the image
+            for (int x = 0; x < w; x++) {
+                if ((dst[x] >> 24) == 0) {
+                    dst[x] = 0xFF000000;
+                }
+            }
+        }
+    }
+    bg->frame = bg->composed;
+}
+
+// packed page counterparts of the span operations on the pixels x to x+w-1 of a row,
+// the odd pixels at either end are written by nibble, the bytes between by the kernels
+static inline void _game_packed_fill(uint8_t* row, int x, int w, uint8_t color) {
+    if (x & 1) {
+        _game_nibble_set(row, x++, color);
+        w--;
+    }
+    if (w & 1) {
+        _game_nibble_set(row, x + w - 1, color);
+    }
+    _game_span_fill(row + (x >> 1), (uint8_t)((color & 0xF) * 0x11), w >> 1);
+}
+
+static inline void _game_packed_or8(uint8_t* row, int x, int w) {
+    if (x & 1) {
+        row[x++ >> 1] |= 0x08;
+        w--;
+    }
+    if (w & 1) {
+        row[(x + w - 1) >> 1] |= 0x80;
+    }
+    _game_span_or8(row + (x >> 1), 0x88, w >> 1);
+}
+
+static inline void _game_packed_copy(uint8_t* row, const uint8_t* src, int x, int w) {
+    if (x & 1) {
+        _game_nibble_set(row, x, _game_nibble_get(src, x));
+        x++;
+        w--;
+    }
+    if (w & 1) {
+        _game_nibble_set(row, x + w - 1, _game_nibble_get(src, x + w - 1));
+    }
+    _game_span_copy(row + (x >> 1), src + (x >> 1), w >> 1);
+}
+
+// a full screen bitmap replaces all the pixels of the page, returns where to write them
+static uint8_t* _game_gfx_begin_bitmap(game_t* game, int buffer) {
+    _game_gfx_bg_clear(game, buffer);
+    // a lazy page needs no writing first
+    _game_gfx_note_rows(game, buffer, 0, GAME_HEIGHT - 1);
+    game->gfx.lazy[buffer].state = GAME_GFX_PAGE_PIXELS;
+    if (game->host.use_display_list) {
+        _game_gfx_reset_list(game, buffer);
+        _game_gfx_begin_write(game, buffer);
+    }
+    return _game_gfx_get_page_ptr(game, buffer);
+}
+
+// after the pixels of the bitmap are written, data is the bitmap with one byte per pixel
+static void _game_gfx_end_bitmap(game_t* game, int buffer, const uint8_t* data) {
+    _game_scene_bitmap(game, buffer);
+    _game_gfx_heat_rows(game, buffer, GAME_GFX_WRITE_BITMAP, 0, GAME_HEIGHT);
+    if (game->host.hires) {
+        _game_gfx_hires_upscale(game->host.hires, game->host.hires->fbs[buffer], data);
+    }
+}
+
+// keep the decoded RGB bitmap res_num as an image, in a slot none of the pages but skip refers to
+static void _game_gfx_bg_add(game_t* game, int skip, uint16_t res_num, const uint8_t* rgb, int w, int h) {
+    game_gfx_background_t* bg = game->host.background;
+    if (!bg) {
+        bg = (game_gfx_background_t*)_game_malloc(game, sizeof(game_gfx_background_t));
+        memset(bg, 0, sizeof(game_gfx_background_t));
+        game->host.background = bg;
+    }
+    bool used[GAME_GFX_MAX_BACKGROUNDS] = { false };
+    for (int i = 0; i < 5; i++) {
+        const game_gfx_image_t* img = (i != skip) ? _game_gfx_bg_find(game, game->gfx.bg_res[i]) : 0;
+        if (img) {
+            used[img - bg->images] = true;
+        }
+    }
+    int slot = 0;
+    while (used[slot]) {
+        slot++;
+    }
+    game_gfx_image_t* img = &bg->images[slot];
+    if (img->size < (size_t)w * h) {
+        if (img->pixels) {
+            _game_free(game, img->pixels);
+        }
+        img->size = (size_t)w * h;
+        img->pixels = (uint32_t*)_game_malloc(game, img->size * sizeof(uint32_t));
+    }
+    img->width = w;
+    img->height = h;
+    img->res_num = res_num;
+    for (size_t i = 0; i < (size_t)w * h; i++) {
+        img->pixels[i] = 0xFF000000 | rgb[3 * i] | ((uint32_t)rgb[3 * i + 1] << 8) | ((uint32_t)rgb[3 * i + 2] << 16);
+    }
+}
+
+// keep an RGB bitmap as the background of the page, the page is cleared to color 0 to show it
+static void _game_gfx_draw_background(game_t* game, int buffer, uint16_t res_num, const uint8_t* rgb, int w, int h) {
+    if (!_game_gfx_bg_find(game, res_num)) {
+        _game_gfx_bg_add(game, buffer, res_num, rgb, w, h);
+    }
+    _game_gfx_clear_buffer(game, buffer, 0);
+    game->gfx.bg_res[buffer] = res_num;
+    game->gfx.bg_dy[buffer] = 0;
+    _game_scene_background(game, buffer);
+}
+
+// res_num is the RT_BITMAP resource of data
+static void _game_gfx_draw_bitmap(game_t* game, int buffer, uint16_t res_num, const uint8_t *data, int w, int h, int fmt) {
+    if (fmt == _GFX_FMT_CLUT && GAME_WIDTH == w && GAME_HEIGHT == h) {
+        uint8_t* dst = _game_gfx_begin_bitmap(game, buffer);
+        if (game->host.packed) {
+            _game_packed_pack(dst, data, w * h / 2);
+        } else {
+            memcpy(dst, data, w * h);
+        }
+        _game_gfx_end_bitmap(game, buffer, data);
+        return;
+    }
+    if (fmt == _GFX_FMT_RGB) {
+        _game_gfx_draw_background(game, buffer, res_num, data, w, h);
+        return;
+    }
+    _warning("GraphicsSokol::drawBitmap() unhandled fmt %d w %d h %d", fmt, w, h);
+}
+
+#define _GAME_SPAN_FILL     (0)
+#define _GAME_SPAN_OR8      (1)
+#define _GAME_SPAN_COPY     (2)
+#define _GAME_SPAN_COVER    (3)
+#define _GAME_SPAN_PACKED   (4)     // flag, the spans write a packed page
+
+// what the optional span work needs besides the pixels
+typedef struct {
+    game_gfx_cover_t*   cover;      // coverage of _GAME_SPAN_COVER
+    game_gfx_heatmap_t* heatmap;    // counts the writes into page at the original resolution
+    int                 page;
+    int                 kind;       // game_gfx_write_t of the spans
+    bool                packed;     // page is packed, see game_desc_t.packed_pages
+} _game_span_ctx_t;
+
+static inline int _game_ctz64(uint64_t v) {
+    #if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long i;
+        _BitScanForward64(&i, v);
+        return (int)i;
+    #else
+        return __builtin_ctzll(v);
+    #endif
+}
+
+// first pixel from x to end-1 whose coverage bit differs from skip, end if none
+static int _game_cover_find(const uint64_t* bits, int x, int end, uint64_t skip) {
+    while (x < end) {
+        const uint64_t v = (bits[x >> 6] ^ skip) >> (x & 63);
+        if (v) {
+            return _MIN(x + _game_ctz64(v), end);
+        }
+        x = (x | 63) + 1;
+    }
+    return end;
+}
+
+// fill the pixels of the span not written yet by the commands in front and mark them written,
+// y is the row of the page at the given scale
+static void _game_gfx_cover_span(const _game_span_ctx_t* ctx, int scale, uint8_t* row, int y, int x, int w, uint8_t color) {
+    game_gfx_cover_t* cover = ctx->cover;
+    uint64_t* bits = ((scale == 1) ? cover->rows : cover->hires_rows) + y * (GAME_WIDTH * scale / 64);
+    const int end = x + w;
+    int written = 0;
+    for (int x0 = _game_cover_find(bits, x, end, ~0ULL); x0 < end; ) {
+        const int x1 = _game_cover_find(bits, x0, end, 0);
+        if (ctx->packed) {
+            _game_packed_fill(row, x0, x1 - x0, color);
+        } else {
+            _game_span_fill(row + x0, color, x1 - x0);
+        }
+        if ((scale == 1) && ctx->heatmap) {
+            _game_gfx_heat_span(ctx->heatmap, ctx->page, ctx->kind, y, x0, x1 - x0);
+        }
+        written += x1 - x0;
+        x0 = _game_cover_find(bits, x1, end, ~0ULL);
+    }
+    for (int i = x; i < end; ) {
+        const int n = _MIN(64 - (i & 63), end - i);
+        bits[i >> 6] |= ((n == 64) ? ~0ULL : ((1ULL << n) - 1)) << (i & 63);
+        i += n;
+    }
+    if (scale == 1) {
+        cover->drawn[y] += w;
+        cover->written[y] += written;
+    }
+}
+
+#if defined(_MSC_VER)
+    #define _GAME_FORCE_INLINE __forceinline
+#else
+    #define _GAME_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+// rasterizer loop, always inlined with a constant mode to get one variant per span
+// operation, scale is 1 for the original pages and game_hires_t.scale otherwise,
+// only the rows ystart to yend-1 of the page are written
+static _GAME_FORCE_INLINE void _game_gfx_fill_polygon(uint8_t* dst, const uint8_t* src, uint8_t color, const _game_quad_strip_t* qs, const int mode, const int scale, const int ystart, const int yend, const _game_span_ctx_t* ctx) {
+    const int width = GAME_WIDTH * scale;
+    const int pitch = (mode & _GAME_SPAN_PACKED) ? _GAME_PACKED_PITCH : width;
+    int i = 0;
+    int j = qs->num_vertices - 1;
+
+    int16_t x2 = qs->vertices[i].x;
+    int16_t x1 = qs->vertices[j].x;
+    int16_t hliney = _MIN(qs->vertices[i].y, qs->vertices[j].y);
+
+    ++i;
+    --j;
+
+    uint32_t cpt1 = x1 << 16;
+    uint32_t cpt2 = x2 << 16;
+
+    int numVertices = qs->num_vertices;
+    while (1) {
+        numVertices -= 2;
+        if (numVertices == 0) {
+            return;
+        }
+        uint16_t h;
+        uint32_t step1, step2;
+        if (scale == 1) {
+            step1 = _calc_step(&qs->vertices[j + 1], &qs->vertices[j], &h);
+            step2 = _calc_step(&qs->vertices[i - 1], &qs->vertices[i], &h);
+        } else {
+            step1 = _calc_step_hires(&qs->vertices[j + 1], &qs->vertices[j], &h);
+            step2 = _calc_step_hires(&qs->vertices[i - 1], &qs->vertices[i], &h);
+        }
+
+        ++i;
+        --j;
+
+        cpt1 = (cpt1 & 0xFFFF0000) | 0x7FFF;
+        cpt2 = (cpt2 & 0xFFFF0000) | 0x8000;
+
+        if (h == 0) {
+            cpt1 += step1;
+            cpt2 += step2;
+        } else {
+            if (hliney < ystart) {
+                // advance the edges straight to the first visible row
+                const int skip = _MIN((int)h, ystart - hliney);
+                cpt1 += step1 * (uint32_t)skip;
+                cpt2 += step2 * (uint32_t)skip;
+                hliney += skip;
+                h -= skip;
+            }
+            if (hliney >= yend) return;
+            uint8_t* row = dst + hliney * pitch;
+            const uint8_t* src_row = src + hliney * pitch;
+            while (h--) {
+                x1 = cpt1 >> 16;
+                x2 = cpt2 >> 16;
+                int xmin = 0;
+                int w = 0;
+                if (scale == 1) {
+                    if (x1 < GAME_WIDTH && x2 >= 0) {
+                        if (x1 < 0) x1 = 0;
+                        if (x2 >= GAME_WIDTH) x2 = GAME_WIDTH - 1;
+                        xmin = _MIN(x1, x2);
+                        w = _MAX(x1, x2) - xmin + 1;
+                    }
+                } else {
+                    // the original spans include their last pixel, which covers scale pixels here
+                    xmin = _MAX(_MIN(x1, x2), 0);
+                    w = _MIN(_MAX(x1, x2) + scale - 1, width - 1) - xmin + 1;
+                }
+                if (w > 0) {
+                    switch (mode) {
+                    case _GAME_SPAN_FILL: _game_span_fill(row + xmin, color, w); break;
+                    case _GAME_SPAN_OR8: _game_span_or8(row + xmin, 8, w); break;
+                    case _GAME_SPAN_COPY: _game_span_copy(row + xmin, src_row + xmin, w); break;
+                    case _GAME_SPAN_COVER: _game_gfx_cover_span(ctx, scale, row, hliney, xmin, w, color); break;
+                    case _GAME_SPAN_FILL | _GAME_SPAN_PACKED: _game_packed_fill(row, xmin, w, color); break;
+                    case _GAME_SPAN_OR8 | _GAME_SPAN_PACKED: _game_packed_or8(row, xmin, w); break;
+                    case _GAME_SPAN_COPY | _GAME_SPAN_PACKED: _game_packed_copy(row, src_row, xmin, w); break;
+                    case _GAME_SPAN_COVER | _GAME_SPAN_PACKED: _game_gfx_cover_span(ctx, scale, row, hliney, xmin, w, color); break;
+                    }
+                    if ((scale == 1) && ((mode & 3) != _GAME_SPAN_COVER) && ctx && ctx->heatmap) {
+                        _game_gfx_heat_span(ctx->heatmap, ctx->page, ctx->kind, hliney, xmin, w);
+                    }
+                }
+                cpt1 += step1;
+                cpt2 += step2;
+                row += pitch;
+                src_row += pitch;
+                ++hliney;
+                if (hliney >= yend) return;
+            }
+        }
+    }
+}
+
+static void _game_gfx_fill_polygon_color(uint8_t* dst, uint8_t color, const _game_quad_strip_t* qs, int ystart, int yend, const _game_span_ctx_t* ctx) {
+    if (ctx->packed) {
+        _game_gfx_fill_polygon(dst, dst, color, qs, _GAME_SPAN_FILL | _GAME_SPAN_PACKED, 1, ystart, yend, ctx);
+    } else {
+        _game_gfx_fill_polygon(dst, dst, color, qs, _GAME_SPAN_FILL, 1, ystart, yend, ctx);
+    }
+}
+
+static void _game_gfx_fill_polygon_alpha(uint8_t* dst, const _game_quad_strip_t* qs, int ystart, int yend, const _game_span_ctx_t* ctx) {
+    if (ctx->packed) {
+        _game_gfx_fill_polygon(dst, dst, 0, qs, _GAME_SPAN_OR8 | _GAME_SPAN_PACKED, 1, ystart, yend, ctx);
+    } else {
+        _game_gfx_fill_polygon(dst, dst, 0, qs, _GAME_SPAN_OR8, 1, ystart, yend, ctx);
+    }
+}
+
+static void _game_gfx_fill_polygon_page(uint8_t* dst, const uint8_t* src, const _game_quad_strip_t* qs, int ystart, int yend, const _game_span_ctx_t* ctx) {
+    if (ctx->packed) {
+        _game_gfx_fill_polygon(dst, src, 0, qs, _GAME_SPAN_COPY | _GAME_SPAN_PACKED, 1, ystart, yend, ctx);
+    } else {
+        _game_gfx_fill_polygon(dst, src, 0, qs, _GAME_SPAN_COPY, 1, ystart, yend, ctx);
+    }
+}
+
+static void _game_gfx_draw_polygon(game_t* game, uint8_t color, const _game_quad_strip_t* qs, int ystart, int yend) {
+    uint8_t* dst = _game_gfx_get_draw_page_ptr(game);
+    const _game_span_ctx_t ctx = { .heatmap = game->host.heatmap, .page = game->gfx.draw_page, .kind = _game_gfx_heat_kind(color), .packed = game->host.packed };
+    switch (color) {
+    default:
+        _game_gfx_fill_polygon_color(dst, color, qs, ystart, yend, &ctx);
+        break;
+    case _GFX_COL_PAGE: {
+        const int src = _game_gfx_page_pixels(game, 0);
+        if (src < 0) {
+            _game_gfx_fill_polygon_color(dst, game->gfx.lazy[0].color, qs, ystart, yend, &ctx);
+        } else if (src != game->gfx.draw_page) {
+            // copying page 0 onto itself changes nothing
+            _game_gfx_fill_polygon_page(dst, game->gfx.fbs[src].buffer, qs, ystart, yend, &ctx);
+        }
+        break;
+    }
+    case _GFX_COL_ALPHA:
+        _game_gfx_fill_polygon_alpha(dst, qs, ystart, yend, &ctx);
+        break;
+    }
+}
+
+static void _game_gfx_hires_draw_polygon(game_t* game, uint8_t color, const _game_quad_strip_t* qs, int ystart, int yend) {
+    const game_hires_t* hr = game->host.hires;
+    uint8_t* dst = hr->fbs[game->gfx.draw_page];
+    const int s = hr->scale;
+    switch (color) {
+    default:
+        _game_gfx_fill_polygon(dst, dst, color, qs, _GAME_SPAN_FILL, s, ystart * s, yend * s, 0);
+        break;
+    case _GFX_COL_PAGE: {
+        const int src = _game_gfx_page_pixels(game, 0);
+        if (src < 0) {
+            _game_gfx_fill_polygon(dst, dst, game->gfx.lazy[0].color, qs, _GAME_SPAN_FILL, s, ystart * s, yend * s, 0);
+        } else if (src != game->gfx.draw_page) {
+            _game_gfx_fill_polygon(dst, hr->fbs[src], 0, qs, _GAME_SPAN_COPY, s, ystart * s, yend * s, 0);
+        }
+        break;
+    }
+    case _GFX_COL_ALPHA:
+        _game_gfx_fill_polygon(dst, dst, 0, qs, _GAME_SPAN_OR8, s, ystart * s, yend * s, 0);
+        break;
+    }
+}
+
+static int16_t _game_gfx_hires_coord(int32_t v) {
+    return (int16_t)_MAX(_MIN(v, INT16_MAX), INT16_MIN);
+}
+
+// scale the polygon data at p by zoom into poly and the vertex arrays, the high resolution
+// vertices are only written with a scale above 1, returns false for invalid data
+static bool _game_gfx_scale_polygon(const uint8_t* p, uint16_t zoom, int scale, game_shape_polygon_t* poly, int16_t* vx, int16_t* vy, int32_t* hx, int32_t* hy) {
+    poly->bbw = p[0] * zoom / 64;
+    poly->bbh = p[1] * zoom / 64;
+    const uint8_t num_vertices = p[2];
+    if ((num_vertices & 1) != 0) {
+        _warning("Unexpected number of vertices %d", num_vertices);
+        return false;
+    }
+    GAME_ASSERT(num_vertices < GAME_QUAD_STRIP_MAX_VERTICES);
+    poly->num_vertices = num_vertices;
+    const uint8_t* v = p + 3;
+    for (int i = 0; i < num_vertices; i++) {
+        vx[i] = (int16_t)(v[2 * i] * zoom / 64);
+        vy[i] = (int16_t)(v[2 * i + 1] * zoom / 64);
+        if (scale > 1) {
+            hx[i] = v[2 * i] * zoom * scale / 64;
+            hy[i] = v[2 * i + 1] * zoom * scale / 64;
+        }
+    }
+    // the rasterizer advances by the height of the segments of one side
+    int rows = 0;
+    for (int i = 1; i < num_vertices / 2; i++) {
+        rows += (uint16_t)(vy[i] - vy[i - 1]);
+    }
+    poly->rows = (uint16_t)_MIN(rows, UINT16_MAX);
+    return true;
+}
+
+static bool _game_gfx_polygon_is_point(const game_shape_polygon_t* poly) {
+    return poly->num_vertices == 4 && poly->bbw == 0 && poly->bbh <= 1;
+}
+
+static bool _game_gfx_polygon_visible(const game_shape_polygon_t* poly, const _game_point_t *pt) {
+    const int16_t x1 = pt->x - poly->bbw / 2;
+    const int16_t x2 = pt->x + poly->bbw / 2;
+    const int16_t y1 = pt->y - poly->bbh / 2;
+    const int16_t y2 = pt->y + poly->bbh / 2;
+    return !(x1 > 319 || x2 < 0 || y1 > 199 || y2 < 0);
+}
+
+// rows reached by the scaled polygon drawn at pt
+static void _game_gfx_polygon_rows(const game_shape_polygon_t* poly, const int16_t* vy, const _game_point_t *pt, int16_t* top, int16_t* bottom) {
+    if (_game_gfx_polygon_is_point(poly)) {
+        *top = *bottom = pt->y;
+        return;
+    }
+    if (poly->num_vertices < 2) {
+        *top = 0;
+        *bottom = GAME_HEIGHT - 1;
+        return;
+    }
+    const int16_t y1 = pt->y - poly->bbh / 2;
+    const int16_t first = y1 + vy[0];
+    const int16_t last = y1 + vy[poly->num_vertices - 1];
+    *top = _MIN(first, last);
+    // the last row is included for the fraction of the high resolution vertices
+    *bottom = (int16_t)_MIN(*top + poly->rows, INT16_MAX);
+}
+
+// vertices of the scaled polygon drawn at pt, at the original resolution when scale is 1
+static void _game_gfx_polygon_strip(const _game_point_t *pt, const game_shape_polygon_t* poly, const _game_vertices_t* v, int32_t scale, _game_quad_strip_t* qs) {
+    const int16_t x1 = pt->x - poly->bbw / 2;
+    const int16_t y1 = pt->y - poly->bbh / 2;
+    qs->num_vertices = poly->num_vertices;
+    if (scale == 1) {
+        for (int i = 0; i < qs->num_vertices; ++i) {
+            qs->vertices[i].x = x1 + v->x[i];
+            qs->vertices[i].y = y1 + v->y[i];
+        }
+    } else {
+        // same bounding box corner as the original, the vertices keep the fraction of the zoom
+        for (int i = 0; i < qs->num_vertices; ++i) {
+            qs->vertices[i].x = _game_gfx_hires_coord(scale * x1 + v->hx[i]);
+            qs->vertices[i].y = _game_gfx_hires_coord(scale * y1 + v->hy[i]);
+        }
+    }
+}
+
+// rasterize the scaled polygon drawn at pt into the work page
+static void _game_gfx_draw_polygon_vertices(game_t* game, uint8_t color, const _game_point_t *pt, const game_shape_polygon_t* poly, const _game_vertices_t* v, int ystart, int yend) {
+    if (_game_gfx_polygon_is_point(poly)) {
+        _game_gfx_drawPoint(game, pt->x, pt->y, color, ystart, yend);
+        return;
+    }
+    _game_quad_strip_t qs;
+    _game_gfx_polygon_strip(pt, poly, v, 1, &qs);
+    _game_gfx_draw_polygon(game, color, &qs, ystart, yend);
+    if (game->host.hires) {
+        _game_gfx_polygon_strip(pt, poly, v, game->host.hires->scale, &qs);
+        _game_gfx_hires_draw_polygon(game, color, &qs, ystart, yend);
+    }
+}
+
+// rasterize the polygon data recorded in a display list into the work page, front to
+// back under the pixels already covered when cover is true (solid colors only)
+static void _game_gfx_draw_polygon_data(game_t* game, uint8_t color, uint16_t zoom, const _game_point_t *pt, const uint8_t* p, int ystart, int yend, bool cover) {
+    game_shape_polygon_t poly;
+    int16_t vx[GAME_QUAD_STRIP_MAX_VERTICES], vy[GAME_QUAD_STRIP_MAX_VERTICES];
+    int32_t hx[GAME_QUAD_STRIP_MAX_VERTICES], hy[GAME_QUAD_STRIP_MAX_VERTICES];
+    if (!_game_gfx_scale_polygon(p, zoom, game->host.hires ? game->host.hires->scale : 1, &poly, vx, vy, hx, hy)) {
+        return;
+    }
+    const _game_vertices_t v = { vx, vy, hx, hy };
+    if (!cover) {
+        _game_gfx_draw_polygon_vertices(game, color, pt, &poly, &v, ystart, yend);
+        return;
+    }
+    const _game_span_ctx_t cv = { game->host.cover, game->host.heatmap, game->gfx.draw_page, GAME_GFX_WRITE_SOLID, game->host.packed };
+    const game_hires_t* hr = game->host.hires;
+    uint8_t* dst = _game_gfx_get_draw_page_ptr(game);
+    if (_game_gfx_polygon_is_point(&poly)) {
+        if (pt->y >= ystart && pt->y < yend) {
+            _game_gfx_cover_span(&cv, 1, dst + pt->y * (cv.packed ? _GAME_PACKED_PITCH : GAME_WIDTH), pt->y, pt->x, 1, color);
+            if (hr) {
+                for (int j = 0; j < hr->scale; j++) {
+                    const int y = pt->y * hr->scale + j;
+                    _game_gfx_cover_span(&cv, hr->scale, hr->fbs[game->gfx.draw_page] + y * hr->width, y, pt->x * hr->scale, hr->scale, color);
+                }
+            }
+        }
+        return;
+    }
+    _game_quad_strip_t qs;
+    _game_gfx_polygon_strip(pt, &poly, &v, 1, &qs);
+    if (cv.packed) {
+        _game_gfx_fill_polygon(dst, dst, color, &qs, _GAME_SPAN_COVER | _GAME_SPAN_PACKED, 1, ystart, yend, &cv);
+    } else {
+        _game_gfx_fill_polygon(dst, dst, color, &qs, _GAME_SPAN_COVER, 1, ystart, yend, &cv);
+    }
+    if (hr) {
+        const int s = hr->scale;
+        uint8_t* hdst = hr->fbs[game->gfx.draw_page];
+        _game_gfx_polygon_strip(pt, &poly, &v, s, &qs);
+        _game_gfx_fill_polygon(hdst, hdst, color, &qs, _GAME_SPAN_COVER, s, ystart * s, yend * s, &cv);
+    }
+}
+
+// front to back counterpart of _game_gfx_fill_page() for the work page
+static void _game_gfx_cover_fill(game_t* game, uint8_t color, int ystart, int yend) {
+    const _game_span_ctx_t cv = { game->host.cover, game->host.heatmap, game->gfx.draw_page, GAME_GFX_WRITE_CLEAR, game->host.packed };
+    const int pitch = cv.packed ? _GAME_PACKED_PITCH : GAME_WIDTH;
+    uint8_t* dst = _game_gfx_get_draw_page_ptr(game);
+    for (int y = ystart; y < yend; y++) {
+        _game_gfx_cover_span(&cv, 1, dst + y * pitch, y, 0, GAME_WIDTH, color);
+    }
+    const game_hires_t* hr = game->host.hires;
+    if (hr) {
+        for (int y = ystart * hr->scale; y < yend * hr->scale; y++) {
+            _game_gfx_cover_span(&cv, hr->scale, hr->fbs[game->gfx.draw_page] + y * hr->width, y, 0, hr->width, color);
+        }
+    }
+}
+
+static void _game_gfx_cover_init(game_t* game) {
+    const int s = game->host.hires ? game->host.hires->scale : 1;
+    const size_t words = GAME_HEIGHT * GAME_WIDTH / 64;
+    const size_t size = sizeof(game_gfx_cover_t) + (words + ((s > 1) ? words * s * s : 0)) * sizeof(uint64_t);
+    game_gfx_cover_t* cover = (game_gfx_cover_t*)_game_malloc(game, size);
+    memset(cover, 0, size);
+    cover->rows = (uint64_t*)(cover + 1);
+    cover->hires_rows = (s > 1) ? cover->rows + words : 0;
+    game->host.cover = cover;
+}
+
+static void _game_gfx_cover_discard(game_t* game) {
+    if (game->host.cover) {
+        _game_free(game, game->host.cover);
+        game->host.cover = 0;
+    }
+}
+
+static void _game_gfx_draw_polygon_shape(game_t* game, int buffer, uint8_t color, uint16_t zoom, const _game_point_t *pt, const game_shape_polygon_t* poly, const _game_vertices_t* v) {
+    if (!_game_gfx_polygon_visible(poly, pt)) {
+        return;
+    }
+    if (game->host.scene) {
+        if (_game_gfx_polygon_is_point(poly)) {
+            _game_scene_point(game, buffer, color, pt);
+        } else {
+            _game_quad_strip_t qs;
+            _game_gfx_polygon_strip(pt, poly, v, 1, &qs);
+            _game_scene_polygon(game, buffer, color, &qs);
+        }
+        if (game->host.scene->desc.no_raster) {
+            return;
+        }
+    }
+    int16_t top, bottom;
+    _game_gfx_polygon_rows(poly, v->y, pt, &top, &bottom);
+    _game_gfx_mark_rows(game, buffer, top, bottom);
+    if (game->host.use_display_list) {
+        const int size = 3 + poly->num_vertices * 2;
+        game_gfx_cmd_t* cmd = _game_gfx_record(game, buffer, GAME_GFX_CMD_POLYGON, color, pt, size);
+        cmd->zoom = zoom;
+        cmd->top = top;
+        cmd->bottom = bottom;
+        memcpy(game->host.lists[buffer].data + cmd->data, _game_res_ptr(game, poly->data), size);
+        return;
+    }
+    _game_gfx_set_work_page(game, buffer);
+    _game_gfx_draw_polygon_vertices(game, color, pt, poly, v, 0, GAME_HEIGHT);
+}
+
+// Video
+static void _game_video_read_palette_ega(const uint8_t *buf, int num, uint32_t pal[16]) {
     const uint8_t *p = buf + num * 16 * sizeof(uint16_t);
     p += 1024; // EGA colors are stored after VGA (Amiga)
     for (int i = 0; i < 16; ++i) {
@@ -1840,15 +4440,28 @@ static void _game_video_read_palette_amiga(const uint8_t *buf, int num, uint32_t
     }
 }
 
-static void _game_video_change_pal(game_t* game, uint8_t palNum) {
-    if (palNum < 32 && palNum != game->video.current_pal) {
-        uint32_t pal[16];
+// expand the 32 palettes of the part just set up
+static void _game_video_read_palettes(game_t* game) {
+    const uint8_t* buf = _game_res_ptr(game, game->res.seg_video_pal);
+    for (int i = 0; i < 32; i++) {
         if (game->res.data_type == DT_DOS && game->video.use_ega) {
-            _game_video_read_palette_ega(game->res.seg_video_pal, palNum, pal);
+            _game_video_read_palette_ega(buf, i, game->video.palettes[i]);
         } else {
-            _game_video_read_palette_amiga(game->res.seg_video_pal, palNum, pal);
+            _game_video_read_palette_amiga(buf, i, game->video.palettes[i]);
+        }
+    }
+}
+
+static void _game_video_change_pal(game_t* game, uint8_t palNum) {
+    if (palNum < 32 && palNum != game->video.current_pal) {
+        if (game->gfx.fix_up_palette && game->host.use_display_list) {
+            // the primitives recorded before the change are replayed before the new colors
+            // apply, the pages keep palette indices so all of them show in the new palette
+            for (int i = 0; i < 4; i++) {
+                _game_gfx_resolve(game, i);
+            }
         }
-        _game_gfx_set_palette(game, pal, 16);
+        _game_gfx_set_palette(game, game->video.palettes[palNum], 16);
         game->video.current_pal = palNum;
     }
 }
@@ -1915,7 +4528,7 @@ static void _game_video_update_display(game_t* game, uint8_t page) {
 
 static void _game_video_draw_string(game_t* game, uint8_t color, uint16_t x, uint16_t y, uint16_t strId) {
     bool escapedChars = false;
-    const char* str = _find_string(game->strings_table, strId);
+    const char* str = _find_string(game->host.strings_table, strId);
     if (!str && game->res.data_type == DT_DOS) {
         str = _find_string(_strings_table_demo, strId);
     }
@@ -1948,43 +4561,18 @@ static void _game_video_draw_string(game_t* game, uint8_t color, uint16_t x, uin
     }
 }
 
-static void _game_video_set_data_buffer(game_t* game, uint8_t *dataBuf, uint16_t offset) {
+static void _game_video_set_data_buffer(game_t* game, uint32_t dataBuf, uint16_t offset) {
     game->video.data_buf = dataBuf;
     game->video.p_data.pc = dataBuf + offset;
 }
 
 static void _game_video_fill_polygon(game_t* game, uint16_t color, uint16_t zoom, const _game_point_t *pt) {
-    const uint8_t *p = game->video.p_data.pc;
-
-    uint16_t bbw = (*p++) * zoom / 64;
-    uint16_t bbh = (*p++) * zoom / 64;
-
-    int16_t x1 = pt->x - bbw / 2;
-    int16_t x2 = pt->x + bbw / 2;
-    int16_t y1 = pt->y - bbh / 2;
-    int16_t y2 = pt->y + bbh / 2;
-
-    if (x1 > 319 || x2 < 0 || y1 > 199 || y2 < 0)
-        return;
-
-    _game_quad_strip_t qs;
-    qs.num_vertices = *p++;
-    if ((qs.num_vertices & 1) != 0) {
-        _warning("Unexpected number of vertices %d", qs.num_vertices);
-        return;
-    }
-    GAME_ASSERT(qs.num_vertices < GAME_QUAD_STRIP_MAX_VERTICES);
-
-    for (int i = 0; i < qs.num_vertices; ++i) {
-        _game_point_t *v = &qs.vertices[i];
-        v->x = x1 + (*p++) * zoom / 64;
-        v->y = y1 + (*p++) * zoom / 64;
-    }
-
-    if (qs.num_vertices == 4 && bbw == 0 && bbh <= 1) {
-        _game_gfx_draw_point(game, game->video.buffers[0], color, pt);
-    } else {
-        _game_gfx_draw_quad_strip(game, game->video.buffers[0], color, &qs);
+    game_shape_polygon_t poly = { .data = game->video.p_data.pc };
+    int16_t vx[GAME_QUAD_STRIP_MAX_VERTICES], vy[GAME_QUAD_STRIP_MAX_VERTICES];
+    int32_t hx[GAME_QUAD_STRIP_MAX_VERTICES], hy[GAME_QUAD_STRIP_MAX_VERTICES];
+    if (_game_gfx_scale_polygon(_game_res_ptr(game, poly.data), zoom, game->host.hires ? game->host.hires->scale : 1, &poly, vx, vy, hx, hy)) {
+        const _game_vertices_t v = { vx, vy, hx, hy };
+        _game_gfx_draw_polygon_shape(game, game->video.buffers[0], (uint8_t)color, zoom, pt, &poly, &v);
     }
 }
 
@@ -1992,23 +4580,23 @@ static void _game_video_draw_shape(game_t* game, uint8_t color, uint16_t zoom, c
 
 static void _game_video_draw_shape_parts(game_t* game, uint16_t zoom, const _game_point_t *pgc) {
     _game_point_t pt;
-    pt.x = pgc->x - _fetch_byte(&game->video.p_data) * zoom / 64;
-    pt.y = pgc->y - _fetch_byte(&game->video.p_data) * zoom / 64;
-    int16_t n = _fetch_byte(&game->video.p_data);
+    pt.x = pgc->x - _fetch_byte(game, &game->video.p_data) * zoom / 64;
+    pt.y = pgc->y - _fetch_byte(game, &game->video.p_data) * zoom / 64;
+    int16_t n = _fetch_byte(game, &game->video.p_data);
     _debug(GAME_DBG_VIDEO, "Video::drawShapeParts n=%d", n);
     for ( ; n >= 0; --n) {
-        uint16_t offset = _fetch_word(&game->video.p_data);
+        uint16_t offset = _fetch_word(game, &game->video.p_data);
         _game_point_t po = {.x = pt.x, .y = pt.y};
-        po.x += _fetch_byte(&game->video.p_data) * zoom / 64;
-        po.y += _fetch_byte(&game->video.p_data) * zoom / 64;
+        po.x += _fetch_byte(game, &game->video.p_data) * zoom / 64;
+        po.y += _fetch_byte(game, &game->video.p_data) * zoom / 64;
         uint16_t color = 0xFF;
         if (offset & 0x8000) {
-            color = _fetch_byte(&game->video.p_data);
-            _fetch_byte(&game->video.p_data);
+            color = _fetch_byte(game, &game->video.p_data);
+            _fetch_byte(game, &game->video.p_data);
             color &= 0x7F;
         }
         offset <<= 1;
-        uint8_t *bak = game->video.p_data.pc;
+        const uint32_t bak = game->video.p_data.pc;
         game->video.p_data.pc = game->video.data_buf + offset;
         _game_video_draw_shape(game, color, zoom, &po);
         game->video.p_data.pc = bak;
@@ -2016,7 +4604,7 @@ static void _game_video_draw_shape_parts(game_t* game, uint16_t zoom, const _gam
 }
 
 static void _game_video_draw_shape(game_t* game, uint8_t color, uint16_t zoom, const _game_point_t *pt) {
-    uint8_t i = _fetch_byte(&game->video.p_data);
+    uint8_t i = _fetch_byte(game, &game->video.p_data);
     if (i >= 0xC0) {
         if (color & 0x80) {
             color = i & 0x3F;
@@ -2034,52 +4622,191 @@ static void _game_video_draw_shape(game_t* game, uint8_t color, uint16_t zoom, c
     }
 }
 
-static void _game_video_init(game_t* game) {
-    game->video.next_pal = game->video.current_pal = 0xFF;
-    game->video.buffers[2] = _game_video_get_page_ptr(game, 1);
-    game->video.buffers[1] = _game_video_get_page_ptr(game, 2);
-    _game_video_set_work_page_ptr(game, 0xfe);
+// Shapes
+#define _GAME_SHAPE_MAX_DEPTH (8)
+
+static void _game_shape_init(game_t* game) {
+    const size_t hires_size = game->host.hires ? 2 * GAME_SHAPE_CACHE_VERTICES * sizeof(int32_t) : 0;
+    game_shape_cache_t* sc = (game_shape_cache_t*)_game_malloc(game, sizeof(game_shape_cache_t) + hires_size);
+    memset(sc, 0, sizeof(game_shape_cache_t));
+    if (hires_size > 0) {
+        sc->hx = (int32_t*)(sc + 1);
+        sc->hy = sc->hx + GAME_SHAPE_CACHE_VERTICES;
+    }
+    game->host.shapes = sc;
 }
 
-static void _decode_amiga(const uint8_t *src, uint8_t *dst) {
-    static const int plane_size = GAME_HEIGHT * GAME_WIDTH / 8;
-    for (int y = 0; y < GAME_HEIGHT; ++y) {
-        for (int x = 0; x < GAME_WIDTH; x += 8) {
-            for (int b = 0; b < 8; ++b) {
-                const int mask = 1 << (7 - b);
-                uint8_t color = 0;
-                for (int p = 0; p < 4; ++p) {
-                    if (src[p * plane_size] & mask) {
-                        color |= 1 << p;
-                    }
-                }
-                *dst++ = color;
-            }
-            ++src;
+static void _game_shape_discard(game_t* game) {
+    if (game->host.shapes) {
+        _game_free(game, game->host.shapes);
+        game->host.shapes = 0;
+    }
+}
+
+static void _game_shape_reset(game_t* game) {
+    game_shape_cache_t* sc = game->host.shapes;
+    if (!sc) {
+        return;
+    }
+    memset(sc->shapes, 0, sizeof(sc->shapes));
+    sc->num_shapes = 0;
+    sc->num_polygons = 0;
+    sc->num_vertices = 0;
+}
+
+// append the polygons of the shape tree at pc the way _game_video_draw_shape() walks it,
+// positions relative to the root, returns false when the tree doesn't fit in the cache
+static bool _game_shape_compile(game_t* game, game_pc_t* pc, uint32_t data_buf, uint8_t color, uint16_t zoom, _game_point_t pt, int depth) {
+    game_shape_cache_t* sc = game->host.shapes;
+    uint8_t i = _fetch_byte(game, pc);
+    if (i >= 0xC0) {
+        if (color & 0x80) {
+            color = i & 0x3F;
+        }
+        const uint8_t* p = _game_res_ptr(game, pc->pc);
+        if ((sc->num_polygons >= GAME_SHAPE_CACHE_POLYGONS) || (sc->num_vertices + p[2] > GAME_SHAPE_CACHE_VERTICES)) {
+            return false;
+        }
+        game_shape_polygon_t* poly = &sc->polygons[sc->num_polygons];
+        *poly = (game_shape_polygon_t){ .data = pc->pc, .x = pt.x, .y = pt.y, .vertices = (uint16_t)sc->num_vertices, .color = color };
+        const int n = sc->num_vertices;
+        if (_game_gfx_scale_polygon(p, zoom, game->host.hires ? game->host.hires->scale : 1, poly, sc->vx + n, sc->vy + n, sc->hx ? sc->hx + n : 0, sc->hy ? sc->hy + n : 0)) {
+            sc->num_polygons++;
+            sc->num_vertices += poly->num_vertices;
+        }
+        return true;
+    }
+    i &= 0x3F;
+    if (i != 2) {
+        _warning("Video::drawShape() ec=0x%X (i != 2)", (i == 1) ? 0xF80 : 0xFBB);
+        return true;
+    }
+    if (depth >= _GAME_SHAPE_MAX_DEPTH) {
+        return false;
+    }
+    pt.x -= _fetch_byte(game, pc) * zoom / 64;
+    pt.y -= _fetch_byte(game, pc) * zoom / 64;
+    int16_t n = _fetch_byte(game, pc);
+    for ( ; n >= 0; --n) {
+        uint16_t offset = _fetch_word(game, pc);
+        _game_point_t po = pt;
+        po.x += _fetch_byte(game, pc) * zoom / 64;
+        po.y += _fetch_byte(game, pc) * zoom / 64;
+        uint8_t child_color = 0xFF;
+        if (offset & 0x8000) {
+            child_color = _fetch_byte(game, pc) & 0x7F;
+            _fetch_byte(game, pc);
+        }
+        offset <<= 1;
+        game_pc_t child = { .pc = data_buf + offset };
+        if (!_game_shape_compile(game, &child, data_buf, child_color, zoom, po, depth + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static game_shape_t* _game_shape_find(game_shape_cache_t* sc, uint32_t offset, uint32_t data_buf, uint16_t zoom) {
+    uint32_t i = ((offset * 0x9E3779B1u) ^ (zoom * 0x85EBCA6Bu) ^ data_buf) >> 7;
+    while (true) {
+        i &= GAME_SHAPE_CACHE_SHAPES - 1;
+        game_shape_t* shape = &sc->shapes[i];
+        if (!shape->used || ((shape->offset == offset) && (shape->zoom == zoom) && (shape->data_buf == data_buf))) {
+            return shape;
         }
+        i++;
     }
 }
 
-static void _decode_atari(const uint8_t *src, uint8_t *dst) {
-    for (int y = 0; y < GAME_HEIGHT; ++y) {
-        for (int x = 0; x < GAME_WIDTH; x += 16) {
-            for (int b = 0; b < 16; ++b) {
-                const int mask = 1 << (15 - b);
-                uint8_t color = 0;
-                for (int p = 0; p < 4; ++p) {
-                    if (_read_be_uint16(src + p * 2) & mask) {
-                        color |= 1 << p;
-                    }
-                }
-                *dst++ = color;
+// the compiled shape at video.p_data, 0 when it can't be compiled
+static const game_shape_t* _game_shape_get(game_t* game, uint16_t zoom) {
+    if (!game->host.shapes) {
+        _game_shape_init(game);
+    }
+    game_shape_cache_t* sc = game->host.shapes;
+    const uint32_t offset = game->video.p_data.pc;
+    const uint32_t data_buf = game->video.data_buf;
+    game_shape_t* shape = _game_shape_find(sc, offset, data_buf, zoom);
+    if (shape->used) {
+        return shape;
+    }
+    if (sc->num_shapes >= GAME_SHAPE_CACHE_SHAPES * 3 / 4) {
+        _game_shape_reset(game);
+        shape = _game_shape_find(sc, offset, data_buf, zoom);
+    }
+    while (true) {
+        const int num_polygons = sc->num_polygons;
+        const int num_vertices = sc->num_vertices;
+        const _game_point_t pt = { 0, 0 };
+        game_pc_t pc = { .pc = offset };
+        if (_game_shape_compile(game, &pc, data_buf, 0xFF, zoom, pt, 0)) {
+            *shape = (game_shape_t){
+                .used = true,
+                .zoom = zoom,
+                .offset = offset,
+                .data_buf = data_buf,
+                .end = pc.pc,
+                .polygons = (uint16_t)num_polygons,
+                .num_polygons = (uint16_t)(sc->num_polygons - num_polygons),
+                .x0 = INT32_MAX, .y0 = INT32_MAX, .x1 = INT32_MIN, .y1 = INT32_MIN,
+            };
+            for (int i = num_polygons; i < sc->num_polygons; i++) {
+                const game_shape_polygon_t* poly = &sc->polygons[i];
+                shape->x0 = _MIN(shape->x0, poly->x - poly->bbw / 2);
+                shape->y0 = _MIN(shape->y0, poly->y - poly->bbh / 2);
+                shape->x1 = _MAX(shape->x1, poly->x + poly->bbw / 2);
+                shape->y1 = _MAX(shape->y1, poly->y + poly->bbh / 2);
             }
-            src += 8;
+            sc->num_shapes++;
+            return shape;
+        }
+        sc->num_polygons = num_polygons;
+        sc->num_vertices = num_vertices;
+        if (sc->num_shapes == 0) {
+            return 0;
+        }
+        // out of room, start over with an empty cache
+        _game_shape_reset(game);
+        shape = _game_shape_find(sc, offset, data_buf, zoom);
+    }
+}
+
+// draw the shape at video.p_data with its compiled polygons, or walk its tree when it can't be compiled
+static void _game_video_draw_compiled_shape(game_t* game, uint16_t zoom, const _game_point_t *pt) {
+    const game_shape_t* shape = _game_shape_get(game, zoom);
+    if (!shape) {
+        _game_video_draw_shape(game, 0xFF, zoom, pt);
+        return;
+    }
+    game->video.p_data.pc = shape->end;
+    if (shape->num_polygons == 0) {
+        return;
+    }
+    // reject the whole tree when its box is off screen, unless the 16 bits coordinates
+    // of the polygons wrap around, which the test of each polygon follows
+    const int32_t x0 = pt->x + shape->x0;
+    const int32_t y0 = pt->y + shape->y0;
+    const int32_t x1 = pt->x + shape->x1;
+    const int32_t y1 = pt->y + shape->y1;
+    if ((x0 >= INT16_MIN) && (y0 >= INT16_MIN) && (x1 <= INT16_MAX) && (y1 <= INT16_MAX)) {
+        if ((x0 >= GAME_WIDTH) || (x1 < 0) || (y0 >= GAME_HEIGHT) || (y1 < 0)) {
+            return;
         }
     }
+    const game_shape_cache_t* sc = game->host.shapes;
+    for (int i = 0; i < shape->num_polygons; i++) {
+        const game_shape_polygon_t* poly = &sc->polygons[shape->polygons + i];
+        const _game_point_t po = { (int16_t)(pt->x + poly->x), (int16_t)(pt->y + poly->y) };
+        const _game_vertices_t v = { sc->vx + poly->vertices, sc->vy + poly->vertices, sc->hx ? sc->hx + poly->vertices : 0, sc->hy ? sc->hy + poly->vertices : 0 };
+        _game_gfx_draw_polygon_shape(game, game->video.buffers[0], poly->color, zoom, &po, poly, &v);
+    }
 }
 
-static void _game_video_scale_bitmap(game_t* game, const uint8_t *src, int fmt) {
-    _game_gfx_draw_bitmap(game, game->video.buffers[0], src, GAME_WIDTH, GAME_HEIGHT, fmt);
+static void _game_video_init(game_t* game) {
+    game->video.next_pal = game->video.current_pal = 0xFF;
+    game->video.buffers[2] = _game_video_get_page_ptr(game, 1);
+    game->video.buffers[1] = _game_video_get_page_ptr(game, 2);
+    _game_video_set_work_page_ptr(game, 0xfe);
 }
 
 static void _clut(const uint8_t *src, const uint8_t *pal, int w, int h, int bpp, bool flipY, int colorKey, uint8_t *dst) {
@@ -2142,27 +4869,109 @@ static uint8_t* _decode_bitmap(game_t* game, const uint8_t *src, int *w, int *h)
             }
         }
     }
-    *w = width;
-    *h = height;
-    return dst;
+    *w = width;
+    *h = height;
+    return dst;
+}
+
+static void _game_video_copy_bitmap_ptr(game_t* game, uint16_t res_num, const uint8_t *src) {
+    if (game->res.data_type == DT_DOS || game->res.data_type == DT_AMIGA || game->res.data_type == DT_ATARI) {
+        // decoded straight into the page, the hires pages are upscaled from it (never packed with hires)
+        const int buffer = game->video.buffers[0];
+        uint8_t* dst = _game_gfx_begin_bitmap(game, buffer);
+        _game_decode_planar(game->res.data_type, src, dst, game->host.packed);
+        _game_gfx_end_bitmap(game, buffer, dst);
+    } else { // .BMP
+        int w, h;
+        uint8_t *buf = _decode_bitmap(game, src, &w, &h);
+        if (buf) {
+            _game_gfx_draw_bitmap(game, game->video.buffers[0], res_num, buf, w, h, _GFX_FMT_RGB);
+            _game_free(game, buf);
+        }
+    }
+}
+
+// Bitmap cache
+
+static void _game_bitmap_cache_init(game_t* game, uint32_t max_bytes) {
+    const uint32_t size = game->host.packed ? GAME_WIDTH * GAME_HEIGHT / 2 : GAME_WIDTH * GAME_HEIGHT;
+    const int num = (int)_MIN(max_bytes / size, GAME_BITMAP_CACHE_MAX);
+    if (num == 0) {
+        return;
+    }
+    game_bitmap_cache_t* bc = (game_bitmap_cache_t*)_game_malloc(game, sizeof(game_bitmap_cache_t) + num * size);
+    memset(bc, 0, sizeof(game_bitmap_cache_t));
+    bc->num_entries = num;
+    bc->entry_size = size;
+    uint8_t* pixels = (uint8_t*)(bc + 1);
+    for (int i = 0; i < num; i++) {
+        bc->entries[i].pixels = pixels + i * size;
+    }
+    game->host.bitmaps = bc;
+}
+
+static void _game_bitmap_cache_discard(game_t* game) {
+    if (game->host.bitmaps) {
+        _game_free(game, game->host.bitmaps);
+        game->host.bitmaps = 0;
+    }
+}
+
+static void _game_bitmap_cache_reset(game_t* game) {
+    game_bitmap_cache_t* bc = game->host.bitmaps;
+    if (bc) {
+        for (int i = 0; i < bc->num_entries; i++) {
+            bc->entries[i].last_use = 0;
+        }
+        bc->clock = 0;
+    }
+}
+
+static game_bitmap_entry_t* _game_bitmap_cache_find(game_bitmap_cache_t* bc, int res_num, int data_type) {
+    for (int i = 0; i < bc->num_entries; i++) {
+        game_bitmap_entry_t* e = &bc->entries[i];
+        if (e->last_use && (e->res_num == res_num) && (e->data_type == data_type)) {
+            e->last_use = ++bc->clock;
+            return e;
+        }
+    }
+    return 0;
+}
+
+// the entry to store a new bitmap in, a free one or the least recently used
+static game_bitmap_entry_t* _game_bitmap_cache_add(game_bitmap_cache_t* bc, int res_num, int data_type) {
+    game_bitmap_entry_t* e = &bc->entries[0];
+    for (int i = 1; i < bc->num_entries; i++) {
+        if (bc->entries[i].last_use < e->last_use) {
+            e = &bc->entries[i];
+        }
+    }
+    e->res_num = (uint16_t)res_num;
+    e->data_type = (uint8_t)data_type;
+    e->last_use = ++bc->clock;
+    return e;
+}
+
+// draw the bitmap of the resource if it's in the cache, a single page copy
+static bool _game_video_draw_cached_bitmap(game_t* game, int res_num) {
+    game_bitmap_cache_t* bc = game->host.bitmaps;
+    const game_bitmap_entry_t* e = bc ? _game_bitmap_cache_find(bc, res_num, game->res.data_type) : 0;
+    if (!e) {
+        return false;
+    }
+    const int buffer = game->video.buffers[0];
+    uint8_t* dst = _game_gfx_begin_bitmap(game, buffer);
+    memcpy(dst, e->pixels, bc->entry_size);
+    _game_gfx_end_bitmap(game, buffer, dst);
+    return true;
 }
 
-static void _game_video_copy_bitmap_ptr(game_t* game, const uint8_t *src) {
-    if (game->res.data_type == DT_DOS || game->res.data_type == DT_AMIGA) {
-        uint8_t temp_bitmap[GAME_WIDTH * GAME_HEIGHT];
-        _decode_amiga(src, temp_bitmap);
-        _game_video_scale_bitmap(game, temp_bitmap, _GFX_FMT_CLUT);
-    } else if (game->res.data_type == DT_ATARI) {
-        uint8_t temp_bitmap[GAME_WIDTH * GAME_HEIGHT];
-        _decode_atari(src, temp_bitmap);
-        _game_video_scale_bitmap(game, temp_bitmap, _GFX_FMT_CLUT);
-    } else { // .BMP
-        int w, h;
-        uint8_t *buf = _decode_bitmap(game, src, &w, &h);
-        if (buf) {
-            _game_gfx_draw_bitmap(game, game->video.buffers[0], buf, w, h, _GFX_FMT_RGB);
-            _game_free(game, buf);
-        }
+// keep the bitmap of the resource just drawn by _game_video_copy_bitmap_ptr()
+static void _game_video_cache_bitmap(game_t* game, int res_num) {
+    game_bitmap_cache_t* bc = game->host.bitmaps;
+    if (bc && (game->res.data_type == DT_DOS || game->res.data_type == DT_AMIGA || game->res.data_type == DT_ATARI)) {
+        game_bitmap_entry_t* e = _game_bitmap_cache_add(bc, res_num, game->res.data_type);
+        memcpy(e->pixels, _game_gfx_get_page_ptr(game, game->video.buffers[0]), bc->entry_size);
     }
 }
 
@@ -2173,8 +4982,9 @@ static void _game_audio_stop_sound(game_t* game, uint8_t channel) {
     game->audio.channels[channel].data = 0;
 }
 
-static void _game_audio_init_raw(game_audio_channel_t* chan, const uint8_t *data, int freq, int volume, int mixingFreq) {
-    chan->data = data + 8;
+static void _game_audio_init_raw(game_audio_channel_t* chan, const uint8_t* mem, uint32_t pos, int freq, int volume, int mixingFreq) {
+    const uint8_t* data = mem + pos;
+    chan->data = pos + 8;
     _frac_reset(&chan->pos, freq, mixingFreq);
 
     const int len = _read_be_uint16(data) * 2;
@@ -2185,9 +4995,9 @@ static void _game_audio_init_raw(game_audio_channel_t* chan, const uint8_t *data
     chan->volume = volume;
 }
 
-static void _game_audio_play_sound_raw(game_t* game, uint8_t channel, const uint8_t *data, int freq, uint8_t volume) {
+static void _game_audio_play_sound_raw(game_t* game, uint8_t channel, uint32_t data, int freq, uint8_t volume) {
     game_audio_channel_t* chan = &game->audio.channels[channel];
-    _game_audio_init_raw(chan, data, freq, volume, GAME_MIX_FREQ);
+    _game_audio_init_raw(chan, game->res.mem, data, freq, volume, GAME_MIX_FREQ);
 }
 
 static void _game_play_sfx_music(game_t* game) {
@@ -2222,7 +5032,7 @@ static int16_t _to_raw_i16(int a) {
     return ((a << 8) | a) - 32768;
 }
 
-void _game_audio_mix_raw(game_audio_channel_t* chan, int16_t* sample) {
+void _game_audio_mix_raw(const uint8_t* mem, game_audio_channel_t* chan, int16_t* sample) {
     if (chan->data) {
         uint32_t pos = _frac_get_int(&chan->pos);
         chan->pos.offset += chan->pos.inc;
@@ -2237,24 +5047,24 @@ void _game_audio_mix_raw(game_audio_channel_t* chan, int16_t* sample) {
                 return;
             }
         }
-        *sample = mix_i16(*sample, _to_raw_i16(chan->data[pos] ^ 0x80) * chan->volume / 64);
+        *sample = mix_i16(*sample, _to_raw_i16(mem[chan->data + pos] ^ 0x80) * chan->volume / 64);
     }
 }
 
 static void _game_audio_mix_channels(game_t* game, int16_t *samples, int count) {
     if (kAmigaStereoChannels) {
      for (int i = 0; i < count; i += 2) {
-        _game_audio_mix_raw(&game->audio.channels[0], samples);
-        _game_audio_mix_raw(&game->audio.channels[3], samples);
+        _game_audio_mix_raw(game->res.mem, &game->audio.channels[0], samples);
+        _game_audio_mix_raw(game->res.mem, &game->audio.channels[3], samples);
        ++samples;
-       _game_audio_mix_raw(&game->audio.channels[1], samples);
-       _game_audio_mix_raw(&game->audio.channels[2], samples);
+       _game_audio_mix_raw(game->res.mem, &game->audio.channels[1], samples);
+       _game_audio_mix_raw(game->res.mem, &game->audio.channels[2], samples);
        ++samples;
      }
    } else {
      for (int i = 0; i < count; i += 2) {
        for (int j = 0; j < GAME_MIX_CHANNELS; ++j) {
-            _game_audio_mix_raw(&game->audio.channels[j], &samples[i]);
+            _game_audio_mix_raw(game->res.mem, &game->audio.channels[j], &samples[i]);
        }
        samples[i + 1] = samples[i];
      }
@@ -2315,19 +5125,19 @@ static void _game_res_read_entries(game_t* game) {
     case DT_DOS: {
             game->res.has_password_screen = false; // DOS demo versions do not have the resources
             game_mem_entry_t *me = game->res.mem_list;
-            uint8_t* p = (uint8_t*)game->res.data.mem_list.ptr;
+            uint8_t* p = (uint8_t*)game->host.data.mem_list.ptr;
             while (1) {
                 GAME_ASSERT(game->res.num_mem_list < _ARRAYSIZE(game->res.mem_list));
                 me->status = read_byte(&p);
                 me->type = read_byte(&p);
-                me->buf_ptr = 0; read_uint32_be(&p);
+                me->buf_pos = 0; read_uint32_be(&p);
                 me->rank_num = read_byte(&p);
                 me->bank_num = read_byte(&p);
                 me->bank_pos = read_uint32_be(&p);
                 me->packed_size = read_uint32_be(&p);
                 me->unpacked_size = read_uint32_be(&p);
                 if (me->status == 0xFF) {
-                    game->res.has_password_screen = game->res.data.banks[8].size != 0;
+                    game->res.has_password_screen = game->host.data.banks[8].size != 0;
                     return;
                 }
                 ++game->res.num_mem_list;
@@ -2348,7 +5158,7 @@ static void _game_res_invalidate(game_t* game) {
             me->status = GAME_RES_STATUS_NULL;
         }
     }
-    game->res.script_cur_ptr = game->res.script_bak_ptr;
+    game->res.script_cur_pos = game->res.script_bak_pos;
     game->video.current_pal = 0xFF;
 }
 
@@ -2444,10 +5254,10 @@ static bool _byte_killer_unpack(uint8_t *dst, int dst_size, const uint8_t *src,
 
 
 static bool _game_res_read_bank(game_t* game, const game_mem_entry_t *me, uint8_t *dstBuf) {
-    if(me->bank_num > 0xd || game->res.data.banks[me->bank_num-1].size == 0)
+    if(me->bank_num > 0xd || game->host.data.banks[me->bank_num-1].size == 0)
         return false;
 
-    memcpy(dstBuf, (uint8_t*)game->res.data.banks[me->bank_num-1].ptr + me->bank_pos, me->packed_size);
+    memcpy(dstBuf, (uint8_t*)game->host.data.banks[me->bank_num-1].ptr + me->bank_pos, me->packed_size);
     if (me->packed_size != me->unpacked_size) {
         return _byte_killer_unpack(dstBuf, me->unpacked_size, dstBuf, me->packed_size);
     }
@@ -2459,7 +5269,7 @@ static void _game_res_invalidate_all(game_t* game) {
     for (int i = 0; i < game->res.num_mem_list; ++i) {
         game->res.mem_list[i].status = GAME_RES_STATUS_NULL;
     }
-    game->res.script_cur_ptr = game->res.mem;
+    game->res.script_cur_pos = 0;
     game->video.current_pal = 0xFF;
 }
 
@@ -2482,12 +5292,16 @@ static void _game_res_load(game_t* game) {
 
         const size_t resourceNum = me - game->res.mem_list;
 
-        uint8_t *memPtr = 0;
+        uint32_t memPos = 0;
         if (me->type == RT_BITMAP) {
-            memPtr = game->res.vid_cur_ptr;
+            if (_game_video_draw_cached_bitmap(game, (int)resourceNum)) {
+                me->status = GAME_RES_STATUS_NULL;
+                continue;
+            }
+            memPos = game->res.vid_cur_pos;
         } else {
-            memPtr = game->res.script_cur_ptr;
-            const uint32_t avail = (uint32_t)(game->res.vid_cur_ptr - game->res.script_cur_ptr);
+            memPos = game->res.script_cur_pos;
+            const uint32_t avail = game->res.vid_cur_pos - game->res.script_cur_pos;
             if (me->unpacked_size > avail) {
                 _warning("Resource::load() not enough memory, available=%d", avail);
                 me->status = GAME_RES_STATUS_NULL;
@@ -2498,15 +5312,16 @@ static void _game_res_load(game_t* game) {
             _warning("Resource::load() ec=0x%X (me->bankNum == 0)", 0xF00);
             me->status = GAME_RES_STATUS_NULL;
         } else {
-            _debug(GAME_DBG_BANK, "Resource::load() bufPos=0x%X size=%d type=%d pos=0x%X bankNum=%d", memPtr - game->res.mem, me->packed_size, me->type, me->bank_pos, me->bank_num);
-            if (_game_res_read_bank(game, me, memPtr)) {
+            _debug(GAME_DBG_BANK, "Resource::load() bufPos=0x%X size=%d type=%d pos=0x%X bankNum=%d", memPos, me->packed_size, me->type, me->bank_pos, me->bank_num);
+            if (_game_res_read_bank(game, me, _game_res_ptr(game, memPos))) {
                 if (me->type == RT_BITMAP) {
-                    _game_video_copy_bitmap_ptr(game, game->res.vid_cur_ptr);
+                    _game_video_copy_bitmap_ptr(game, (uint16_t)resourceNum, _game_res_ptr(game, game->res.vid_cur_pos));
+                    _game_video_cache_bitmap(game, (int)resourceNum);
                     me->status = GAME_RES_STATUS_NULL;
                 } else {
-                    me->buf_ptr = memPtr;
+                    me->buf_pos = memPos;
                     me->status = GAME_RES_STATUS_LOADED;
-                    game->res.script_cur_ptr += me->unpacked_size;
+                    game->res.script_cur_pos += me->unpacked_size;
                 }
             } else {
                 if (game->res.data_type == DT_DOS && me->bank_num == 12 && me->type == RT_BANK) {
@@ -2550,6 +5365,7 @@ static void _game_res_setup_part(game_t* game, int ptrId) {
             error("Resource::setupPart() ec=0x%X invalid part", 0xF07);
         }
         _game_res_invalidate_all(game);
+        _game_shape_reset(game);
         game->res.mem_list[ipal].status = GAME_RES_STATUS_TOLOAD;
         game->res.mem_list[icod].status = GAME_RES_STATUS_TOLOAD;
         game->res.mem_list[ivd1].status = GAME_RES_STATUS_TOLOAD;
@@ -2557,16 +5373,17 @@ static void _game_res_setup_part(game_t* game, int ptrId) {
             game->res.mem_list[ivd2].status = GAME_RES_STATUS_TOLOAD;
         }
         _game_res_load(game);
-        game->res.seg_video_pal = game->res.mem_list[ipal].buf_ptr;
-        game->res.seg_code = game->res.mem_list[icod].buf_ptr;
+        game->res.seg_video_pal = game->res.mem_list[ipal].buf_pos;
+        _game_video_read_palettes(game);
+        game->res.seg_code = game->res.mem_list[icod].buf_pos;
         game->res.seg_code_size = game->res.mem_list[icod].unpacked_size;
-        game->res.seg_video1 = game->res.mem_list[ivd1].buf_ptr;
+        game->res.seg_video1 = game->res.mem_list[ivd1].buf_pos;
         if (ivd2 != 0) {
-            game->res.seg_video2 = game->res.mem_list[ivd2].buf_ptr;
+            game->res.seg_video2 = game->res.mem_list[ivd2].buf_pos;
         }
         game->res.current_part = ptrId;
     }
-    game->res.script_bak_ptr = game->res.script_cur_ptr;
+    game->res.script_bak_pos = game->res.script_cur_pos;
 }
 
 static const amiga_mem_entry_t *detect_amiga_atari(game_t* game) {
@@ -2579,7 +5396,7 @@ static const amiga_mem_entry_t *detect_amiga_atari(game_t* game) {
         { 227142, _mem_list_atari_en },
         { 0, 0 }
     };
-    const size_t size = game->res.data.banks[0].size;
+    const size_t size = game->host.data.banks[0].size;
     if (size) {
         for (int i = 0; _files[i].entries; ++i) {
             if (_files[i].bank01_size == size) {
@@ -2591,7 +5408,7 @@ static const amiga_mem_entry_t *detect_amiga_atari(game_t* game) {
 }
 
 static void _game_res_detect_version(game_t* game) {
-    if(game->res.data.mem_list.size) {
+    if(game->host.data.mem_list.size) {
         game->res.data_type = DT_DOS;
         _debug(GAME_DBG_INFO, "Using DOS data files");
     } else {
@@ -2619,22 +5436,22 @@ static void _game_res_detect_version(game_t* game) {
 
 // VM
 static void _op_mov_const(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
-    int16_t n = _fetch_word(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
+    int16_t n = _fetch_word(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_movConst(0x%02X, %d)", i, n);
     game->vm.vars[i] = n;
 }
 
 static void _op_mov(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
-    uint8_t j = _fetch_byte(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
+    uint8_t j = _fetch_byte(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_mov(0x%02X, 0x%02X)", i, j);
     game->vm.vars[i] = game->vm.vars[j];
 }
 
 static void _op_add(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
-    uint8_t j = _fetch_byte(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
+    uint8_t j = _fetch_byte(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_add(0x%02X, 0x%02X)", i, j);
     game->vm.vars[i] += game->vm.vars[j];
 }
@@ -2662,7 +5479,7 @@ static void _snd_playSound(game_t* game, uint16_t resNum, uint8_t freq, uint8_t
     case DT_DOS: {
             game_mem_entry_t *me = &game->res.mem_list[resNum];
             if (me->status == GAME_RES_STATUS_LOADED) {
-                _game_audio_play_sound_raw(game, channel, me->buf_ptr, _get_sound_freq(freq), vol);
+                _game_audio_play_sound_raw(game, channel, me->buf_pos, _get_sound_freq(freq), vol);
             }
         }
         break;
@@ -2686,14 +5503,14 @@ static void _op_add_const(game_t* game) {
             _snd_playSound(game, 0x5B, 1, 64, 1);
         }
     }
-    uint8_t i = _fetch_byte(&game->vm.ptr);
-    int16_t n = _fetch_word(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
+    int16_t n = _fetch_word(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_addConst(0x%02X, %d)", i, n);
     game->vm.vars[i] += n;
 }
 
 static void _op_call(game_t* game) {
-    uint16_t off = _fetch_word(&game->vm.ptr);
+    uint16_t off = _fetch_word(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_call(0x%X)", off);
     if (game->vm.stack_ptr == 0x40) {
         error("Script::op_call() ec=0x%X stack overflow", 0x8F);
@@ -2718,27 +5535,27 @@ static void _op_yieldTask(game_t* game) {
 }
 
 static void _op_jmp(game_t* game) {
-    uint16_t off = _fetch_word(&game->vm.ptr);
+    uint16_t off = _fetch_word(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_jmp(0x%02X)", off);
     game->vm.ptr.pc = game->res.seg_code + off;
 }
 
 static void _op_install_task(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
-    uint16_t n = _fetch_word(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
+    uint16_t n = _fetch_word(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_installTask(0x%X, 0x%X)", i, n);
     GAME_ASSERT(i < GAME_NUM_TASKS);
     game->vm.tasks[i].next_pc = n;
 }
 
 static void _op_jmp_if_var(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_jmpIfVar(0x%02X)", i);
     --game->vm.vars[i];
     if (game->vm.vars[i] != 0) {
         _op_jmp(game);
     } else {
-        _fetch_word(&game->vm.ptr);
+        _fetch_word(game, &game->vm.ptr);
     }
 }
 
@@ -2763,16 +5580,16 @@ static void _fixUpPalette_changeScreen(game_t* game, int part, int screen) {
 }
 
 static void _op_cond_jmp(game_t* game) {
-    uint8_t op = _fetch_byte(&game->vm.ptr);
-    const uint8_t var = _fetch_byte(&game->vm.ptr);;
+    uint8_t op = _fetch_byte(game, &game->vm.ptr);
+    const uint8_t var = _fetch_byte(game, &game->vm.ptr);;
     int16_t b = game->vm.vars[var];
     int16_t a;
     if (op & 0x80) {
-        a = game->vm.vars[_fetch_byte(&game->vm.ptr)];
+        a = game->vm.vars[_fetch_byte(game, &game->vm.ptr)];
     } else if (op & 0x40) {
-        a = _fetch_word(&game->vm.ptr);
+        a = _fetch_word(game, &game->vm.ptr);
     } else {
-        a = _fetch_byte(&game->vm.ptr);
+        a = _fetch_byte(game, &game->vm.ptr);
     }
     _debug(GAME_DBG_SCRIPT, "Script::op_condJmp(%d, 0x%02X, 0x%02X) var=0x%02X", op, b, a, var);
     bool expr = false;
@@ -2826,12 +5643,12 @@ static void _op_cond_jmp(game_t* game) {
             game->vm.screen_num = game->vm.vars[GAME_VAR_SCREEN_NUM];
         }
     } else {
-        _fetch_word(&game->vm.ptr);
+        _fetch_word(game, &game->vm.ptr);
     }
 }
 
 static void _op_set_palette(game_t* game) {
-    uint16_t i = _fetch_word(&game->vm.ptr);
+    uint16_t i = _fetch_word(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_changePalette(%d)", i);
     const int num = i >> 8;
     if (game->gfx.fix_up_palette) {
@@ -2847,13 +5664,13 @@ static void _op_set_palette(game_t* game) {
 }
 
 static void _op_changeTasksState(game_t* game) {
-    uint8_t start = _fetch_byte(&game->vm.ptr);
-    uint8_t end = _fetch_byte(&game->vm.ptr);
+    uint8_t start = _fetch_byte(game, &game->vm.ptr);
+    uint8_t end = _fetch_byte(game, &game->vm.ptr);
     if (end < start) {
         _warning("Script::op_changeTasksState() ec=0x%X (end < start)", 0x880);
         return;
     }
-    uint8_t state = _fetch_byte(&game->vm.ptr);
+    uint8_t state = _fetch_byte(game, &game->vm.ptr);
 
     _debug(GAME_DBG_SCRIPT, "Script::op_changeTasksState(%d, %d, %d)", start, end, state);
 
@@ -2869,21 +5686,21 @@ static void _op_changeTasksState(game_t* game) {
 }
 
 static void _op_selectPage(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_selectPage(%d)", i);
     _game_video_set_work_page_ptr(game, i);
 }
 
 static void _op_fillPage(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
-    uint8_t color = _fetch_byte(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
+    uint8_t color = _fetch_byte(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_fillPage(%d, %d)", i, color);
     _game_video_fill_page(game, i, color);
 }
 
 static void _op_copyPage(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
-    uint8_t j = _fetch_byte(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
+    uint8_t j = _fetch_byte(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_copyPage(%d, %d)", i, j);
     _game_video_copy_page(game, i, j, game->vm.vars[GAME_VAR_SCROLL_Y]);
 }
@@ -2909,7 +5726,7 @@ static void _inp_handleSpecialKeys(game_t* game) {
 }
 
 static void _op_updateDisplay(game_t* game) {
-    uint8_t page = _fetch_byte(&game->vm.ptr);
+    uint8_t page = _fetch_byte(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_updateDisplay(%d)", page);
     _inp_handleSpecialKeys(game);
 
@@ -2941,60 +5758,60 @@ static void _op_removeTask(game_t* game) {
 }
 
 static void _op_drawString(game_t* game) {
-    uint16_t strId = _fetch_word(&game->vm.ptr);
-    uint16_t x = _fetch_byte(&game->vm.ptr);
-    uint16_t y = _fetch_byte(&game->vm.ptr);
-    uint16_t col = _fetch_byte(&game->vm.ptr);
+    uint16_t strId = _fetch_word(game, &game->vm.ptr);
+    uint16_t x = _fetch_byte(game, &game->vm.ptr);
+    uint16_t y = _fetch_byte(game, &game->vm.ptr);
+    uint16_t col = _fetch_byte(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_drawString(0x%03X, %d, %d, %d)", strId, x, y, col);
     _game_video_draw_string(game, col, x, y, strId);
 }
 
 static void _op_sub(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
-    uint8_t j = _fetch_byte(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
+    uint8_t j = _fetch_byte(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_sub(0x%02X, 0x%02X)", i, j);
     game->vm.vars[i] -= game->vm.vars[j];
 }
 
 static void _op_and(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
-    uint16_t n = _fetch_word(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
+    uint16_t n = _fetch_word(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_and(0x%02X, %d)", i, n);
     game->vm.vars[i] = (uint16_t)game->vm.vars[i] & n;
 }
 
 static void _op_or(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
-    uint16_t n = _fetch_word(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
+    uint16_t n = _fetch_word(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_or(0x%02X, %d)", i, n);
     game->vm.vars[i] = (uint16_t)game->vm.vars[i] | n;
 }
 
 static void _op_shl(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
-    uint16_t n = _fetch_word(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
+    uint16_t n = _fetch_word(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_shl(0x%02X, %d)", i, n);
     game->vm.vars[i] = (uint16_t)game->vm.vars[i] << n;
 }
 
 static void _op_shr(game_t* game) {
-    uint8_t i = _fetch_byte(&game->vm.ptr);
-    uint16_t n = _fetch_word(&game->vm.ptr);
+    uint8_t i = _fetch_byte(game, &game->vm.ptr);
+    uint16_t n = _fetch_word(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_shr(0x%02X, %d)", i, n);
     game->vm.vars[i] = (uint16_t)game->vm.vars[i] >> n;
 }
 
 static void _op_playSound(game_t* game) {
-    uint16_t resNum = _fetch_word(&game->vm.ptr);
-    uint8_t freq = _fetch_byte(&game->vm.ptr);
-    uint8_t vol = _fetch_byte(&game->vm.ptr);
-    uint8_t channel = _fetch_byte(&game->vm.ptr);
+    uint16_t resNum = _fetch_word(game, &game->vm.ptr);
+    uint8_t freq = _fetch_byte(game, &game->vm.ptr);
+    uint8_t vol = _fetch_byte(game, &game->vm.ptr);
+    uint8_t channel = _fetch_byte(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_playSound(0x%X, %d, %d, %d)", resNum, freq, vol, channel);
     _snd_playSound(game, resNum, freq, vol, channel);
 }
 
 static void _op_updateResources(game_t* game) {
-    uint16_t num = _fetch_word(&game->vm.ptr);
+    uint16_t num = _fetch_word(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_updateResources(%d)", num);
     if (num == 0) {
         _game_audio_stop_all(game);
@@ -3019,9 +5836,9 @@ static void _snd_playMusic(game_t* game, uint16_t resNum, uint16_t delay, uint8_
 }
 
 static void _op_playMusic(game_t* game) {
-    uint16_t resNum = _fetch_word(&game->vm.ptr);
-    uint16_t delay = _fetch_word(&game->vm.ptr);
-    uint8_t pos = _fetch_byte(&game->vm.ptr);
+    uint16_t resNum = _fetch_word(game, &game->vm.ptr);
+    uint16_t delay = _fetch_word(game, &game->vm.ptr);
+    uint8_t pos = _fetch_byte(game, &game->vm.ptr);
     _debug(GAME_DBG_SCRIPT, "Script::op_playMusic(0x%X, %d, %d)", resNum, delay, pos);
     _snd_playMusic(game, resNum, delay, pos);
 }
@@ -3064,16 +5881,16 @@ static const _opcode_func _op_table[] = {
 };
 
 // Demo3 joy
-static void _demo3_joy_read(game_t* game, const uint8_t* buf_ptr, size_t demo3_joy_size) {
-    game->input.demo_joy.buf_ptr = buf_ptr;
+static void _demo3_joy_read(game_t* game, size_t demo3_joy_size) {
     game->input.demo_joy.buf_size = demo3_joy_size;
     game->input.demo_joy.buf_pos = -1;
 }
 
 bool _demo3_joy_start(game_t* game) {
     if (game->input.demo_joy.buf_size > 0) {
-        game->input.demo_joy.keymask = game->input.demo_joy.buf_ptr[0];
-        game->input.demo_joy.counter = game->input.demo_joy.buf_ptr[1];
+        const uint8_t* buf = (const uint8_t*)game->host.data.demo3_joy.ptr;
+        game->input.demo_joy.keymask = buf[0];
+        game->input.demo_joy.counter = buf[1];
         game->input.demo_joy.buf_pos = 2;
         return true;
     }
@@ -3083,8 +5900,9 @@ bool _demo3_joy_start(game_t* game) {
 uint8_t _demo3_joy_update(game_t* game) {
     if (game->input.demo_joy.buf_pos >= 0 && game->input.demo_joy.buf_pos < game->input.demo_joy.buf_size) {
         if (game->input.demo_joy.counter == 0) {
-            game->input.demo_joy.keymask = game->input.demo_joy.buf_ptr[game->input.demo_joy.buf_pos++];
-            game->input.demo_joy.counter = game->input.demo_joy.buf_ptr[game->input.demo_joy.buf_pos++];
+            const uint8_t* buf = (const uint8_t*)game->host.data.demo3_joy.ptr;
+            game->input.demo_joy.keymask = buf[game->input.demo_joy.buf_pos++];
+            game->input.demo_joy.counter = buf[game->input.demo_joy.buf_pos++];
         } else {
             --game->input.demo_joy.counter;
         }
@@ -3108,7 +5926,7 @@ static void _game_vm_restart_at(game_t* game, int part, int pos) {
         //   00CA: updateResources(res=71)
 
         // Use "Another World" title screen if language is set to French
-        const bool awTitleScreen = (game->strings_table == _strings_table_fr);
+        const bool awTitleScreen = (game->host.strings_table == _strings_table_fr);
         game->vm.vars[0x54] = awTitleScreen ? 0x1 : 0x81;
     }
     _game_res_setup_part(game, part);
@@ -3212,13 +6030,13 @@ static void _game_vm_update_input(game_t* game) {
 }
 
 static void _game_vm_execute_task(game_t* game) {
-    uint8_t opcode = _fetch_byte(&game->vm.ptr);
+    uint8_t opcode = _fetch_byte(game, &game->vm.ptr);
     if (opcode & 0x80) {
-        const uint16_t off = ((opcode << 8) | _fetch_byte(&game->vm.ptr)) << 1;
+        const uint16_t off = ((opcode << 8) | _fetch_byte(game, &game->vm.ptr)) << 1;
         game->res.use_seg_video2 = false;
         _game_point_t pt;
-        pt.x = _fetch_byte(&game->vm.ptr);
-        pt.y = _fetch_byte(&game->vm.ptr);
+        pt.x = _fetch_byte(game, &game->vm.ptr);
+        pt.y = _fetch_byte(game, &game->vm.ptr);
         int16_t h = pt.y - 199;
         if (h > 0) {
             pt.y = 199;
@@ -3226,16 +6044,16 @@ static void _game_vm_execute_task(game_t* game) {
         }
         _debug(GAME_DBG_VIDEO, "vid_opcd_0x80 : opcode=0x%X off=0x%X x=%d y=%d", opcode, off, pt.x, pt.y);
         _game_video_set_data_buffer(game, game->res.seg_video1, off);
-        _game_video_draw_shape(game, 0xFF, 64, &pt);
+        _game_video_draw_compiled_shape(game, 64, &pt);
     } else if (opcode & 0x40) {
         _game_point_t pt;
-        const uint8_t offsetHi = _fetch_byte(&game->vm.ptr);
-        const uint16_t off = ((offsetHi << 8) | _fetch_byte(&game->vm.ptr)) << 1;
-        pt.x = _fetch_byte(&game->vm.ptr);
+        const uint8_t offsetHi = _fetch_byte(game, &game->vm.ptr);
+        const uint16_t off = ((offsetHi << 8) | _fetch_byte(game, &game->vm.ptr)) << 1;
+        pt.x = _fetch_byte(game, &game->vm.ptr);
         game->res.use_seg_video2 = false;
         if (!(opcode & 0x20)) {
             if (!(opcode & 0x10)) {
-                pt.x = (pt.x << 8) | _fetch_byte(&game->vm.ptr);
+                pt.x = (pt.x << 8) | _fetch_byte(game, &game->vm.ptr);
             } else {
                 pt.x = game->vm.vars[pt.x];
             }
@@ -3244,10 +6062,10 @@ static void _game_vm_execute_task(game_t* game) {
                 pt.x += 0x100;
             }
         }
-        pt.y = _fetch_byte(&game->vm.ptr);
+        pt.y = _fetch_byte(game, &game->vm.ptr);
         if (!(opcode & 8)) {
             if (!(opcode & 4)) {
-                pt.y = (pt.y << 8) | _fetch_byte(&game->vm.ptr);
+                pt.y = (pt.y << 8) | _fetch_byte(game, &game->vm.ptr);
             } else {
                 pt.y = game->vm.vars[pt.y];
             }
@@ -3255,18 +6073,18 @@ static void _game_vm_execute_task(game_t* game) {
         uint16_t zoom = 64;
         if (!(opcode & 2)) {
             if (opcode & 1) {
-                zoom = game->vm.vars[_fetch_byte(&game->vm.ptr)];
+                zoom = game->vm.vars[_fetch_byte(game, &game->vm.ptr)];
             }
         } else {
             if (opcode & 1) {
                 game->res.use_seg_video2 = true;
             } else {
-                zoom = _fetch_byte(&game->vm.ptr);
+                zoom = _fetch_byte(game, &game->vm.ptr);
             }
         }
         _debug(GAME_DBG_VIDEO, "vid_opcd_0x40 : off=0x%X x=%d y=%d", off, pt.x, pt.y);
         _game_video_set_data_buffer(game, game->res.use_seg_video2 ? game->res.seg_video2 : game->res.seg_video1, off);
-        _game_video_draw_shape(game, 0xFF, zoom, &pt);
+        _game_video_draw_compiled_shape(game, zoom, &pt);
     } else {
         if (opcode > 0x1A) {
             error("Script::executeTask() ec=0x%X invalid opcode=0x%X", 0xFFF, opcode);
@@ -3315,13 +6133,197 @@ static bool _game_vm_run(game_t* game) {
     return result;
 }
 
+// Snapshot streams, the layout is described before _game_snapshot_page()
+#define _GAME_SNAPSHOT_MAGIC        (0x53574152) // 'RAWS'
+#define _GAME_SNAPSHOT_HEADER_SIZE  (20)
+#define _GAME_SNAPSHOT_STATE_SIZE   ((uint32_t)offsetof(game_t, host))
+#define _GAME_SNAPSHOT_NUM_PAGES    (5)
+#define _GAME_SNAPSHOT_PAGE_RAW     (0)
+#define _GAME_SNAPSHOT_PAGE_PACKED  (1)
+#define _GAME_SNAPSHOT_PAGE_SIZE    (GAME_WIDTH * GAME_HEIGHT)
+#define _GAME_SNAPSHOT_LISTS        (1 << 0)
+#define _GAME_SNAPSHOT_HIRES        (1 << 1)
+// upper bound of the high resolution section at the given scale
+#define _GAME_SNAPSHOT_HIRES_SIZE(scale) (1 + _GAME_SNAPSHOT_NUM_PAGES * (1 + _GAME_SNAPSHOT_PAGE_SIZE * (scale) * (scale)))
+
+// Rewind
+/*
+    A delta is a sequence of chunks: uint16_t count of unchanged bytes,
+    uint16_t count of literal bytes, then the literal bytes XOR'ed. Short
+    runs of unchanged bytes stay in the literal run, so the encoded size
+    never exceeds _GAME_REWIND_DELTA_BOUND(n).
+*/
+#define _GAME_REWIND_MIN_SKIP           (4)
+#define _GAME_REWIND_DELTA_BOUND(n)     ((n) + 32 + 8 * ((n) >> 16))
+// the optional sections of the captured snapshot streams
+#define _GAME_REWIND_SECTIONS           (_GAME_SNAPSHOT_LISTS | _GAME_SNAPSHOT_HIRES)
+
+static size_t _game_snapshot_save(game_t* game, uint8_t* dst, size_t dst_size, uint32_t sections);
+
+static bool _game_rewind_is_skip(const uint8_t* a, const uint8_t* b, uint32_t i, uint32_t n) {
+    const uint32_t end = _MIN(i + _GAME_REWIND_MIN_SKIP, n);
+    for (; i < end; i++) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t _game_rewind_encode(uint8_t* dst, const uint8_t* a, const uint8_t* b, uint32_t n) {
+    uint8_t* ptr = dst;
+    uint32_t i = 0;
+    while (i < n) {
+        uint32_t skip = 0;
+        while (((i + 8) <= n) && ((skip + 8) <= 0xFFFF) && (0 == memcmp(a + i, b + i, 8))) {
+            skip += 8;
+            i += 8;
+        }
+        while ((i < n) && (skip < 0xFFFF) && (a[i] == b[i])) {
+            skip++;
+            i++;
+        }
+        uint8_t* hdr = ptr;
+        ptr += 4;
+        uint32_t lit = 0;
+        // 8 bytes which all differ are literal whatever follows them
+        while (((i + 8) <= n) && ((lit + 8) <= 0xFFFF)) {
+            uint64_t va, vb;
+            memcpy(&va, a + i, 8);
+            memcpy(&vb, b + i, 8);
+            const uint64_t x = va ^ vb;
+            if ((x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL) {
+                break;
+            }
+            memcpy(ptr, &x, 8);
+            ptr += 8;
+            lit += 8;
+            i += 8;
+        }
+        while ((i < n) && (lit < 0xFFFF) && !_game_rewind_is_skip(a, b, i, n)) {
+            *ptr++ = a[i] ^ b[i];
+            lit++;
+            i++;
+        }
+        hdr[0] = skip & 0xFF;
+        hdr[1] = skip >> 8;
+        hdr[2] = lit & 0xFF;
+        hdr[3] = lit >> 8;
+    }
+    return (uint32_t)(ptr - dst);
+}
+
+static void _game_rewind_apply(uint8_t* dst, const uint8_t* src, uint32_t size) {
+    const uint8_t* end = src + size;
+    while (src < end) {
+        dst += src[0] | (src[1] << 8);
+        const int lit = src[2] | (src[3] << 8);
+        src += 4;
+        for (int i = 0; i < lit; i++) {
+            *dst++ ^= *src++;
+        }
+    }
+}
+
+static void _game_rewind_drop_oldest(game_rewind_t* rw) {
+    rw->first = (rw->first + 1) % GAME_REWIND_MAX_FRAMES;
+    rw->num_frames--;
+}
+
+static void _game_rewind_init(game_t* game, uint32_t max_bytes) {
+    game_rewind_t* rw = (game_rewind_t*)_game_malloc(game, sizeof(game_rewind_t));
+    memset(rw, 0, sizeof(game_rewind_t));
+    rw->buf = (uint8_t*)_game_malloc(game, max_bytes);
+    rw->buf_size = max_bytes;
+    // a snapshot stream with the commands recorded on the pages and the high resolution pages
+    rw->stream_size = (uint32_t)(GAME_SNAPSHOT_MAX_SIZE + 4 * sizeof(game_gfx_list_t));
+    if (game->host.hires) {
+        rw->stream_size += _GAME_SNAPSHOT_HIRES_SIZE(game->host.hires->scale);
+    }
+    // both streams stay zero beyond their size, so deltas of streams with different sizes work
+    rw->streams = (uint8_t*)_game_malloc(game, 2 * (size_t)rw->stream_size);
+    memset(rw->streams, 0, 2 * (size_t)rw->stream_size);
+    rw->cur = rw->streams;
+    rw->next = rw->streams + rw->stream_size;
+    game->host.rewind = rw;
+}
+
+static void _game_rewind_discard(game_t* game) {
+    game_rewind_t* rw = game->host.rewind;
+    if (rw) {
+        GAME_ASSERT((rw->cur == rw->streams) || (rw->next == rw->streams));
+        _game_free(game, rw->streams);
+        _game_free(game, rw->buf);
+        _game_free(game, rw);
+        game->host.rewind = 0;
+    }
+}
+
+// called at the end of each VM frame
+static void _game_rewind_capture(game_t* game) {
+    game_rewind_t* rw = game->host.rewind;
+    const uint32_t size = (uint32_t)_game_snapshot_save(game, rw->next, rw->stream_size, _GAME_REWIND_SECTIONS);
+    if (rw->next_size > size) {
+        memset(rw->next + size, 0, rw->next_size - size);
+    }
+    rw->next_size = size;
+    if (rw->cur_size > 0) {
+        const uint32_t n = _MAX(rw->cur_size, size);
+        const uint32_t bound = _GAME_REWIND_DELTA_BOUND(n);
+        if (bound > rw->buf_size) {
+            rw->num_frames = 0;
+        } else {
+            if ((rw->head + bound) > rw->buf_size) {
+                // frames behind the write position are left from the previous lap, thus the oldest
+                while ((rw->num_frames > 0) && (rw->frames[rw->first].pos >= rw->head)) {
+                    _game_rewind_drop_oldest(rw);
+                }
+                rw->head = 0;
+            }
+            while (rw->num_frames > 0) {
+                const game_rewind_frame_t* oldest = &rw->frames[rw->first];
+                const bool overlap = (oldest->pos < (rw->head + bound)) && (rw->head < (oldest->pos + oldest->size));
+                if (!overlap && (rw->num_frames < GAME_REWIND_MAX_FRAMES)) {
+                    break;
+                }
+                _game_rewind_drop_oldest(rw);
+            }
+            game_rewind_frame_t* frame = &rw->frames[(rw->first + rw->num_frames) % GAME_REWIND_MAX_FRAMES];
+            frame->pos = rw->head;
+            frame->size = _game_rewind_encode(rw->buf + rw->head, rw->cur, rw->next, n);
+            frame->stream_size = rw->cur_size;
+            frame->elapsed = rw->cur_elapsed;
+            rw->head += frame->size;
+            rw->num_frames++;
+        }
+    }
+    uint8_t* tmp = rw->cur;
+    rw->cur = rw->next;
+    rw->next = tmp;
+    rw->next_size = rw->cur_size;
+    rw->cur_size = size;
+    rw->cur_elapsed = game->elapsed;
+}
+
 // Game
+static void _game_bind_buffers(game_t* game, game_buffers_t* buffers) {
+    game->host.buffers = buffers;
+    game->res.mem = buffers ? buffers->mem : 0;
+    game->gfx.fbs = buffers ? buffers->fbs : 0;
+    game->gfx.fb = buffers ? buffers->fb : 0;
+    game->audio.samples = buffers ? buffers->samples : 0;
+    game->audio.sample_buffer = buffers ? buffers->sample_buffer : 0;
+}
+
 void game_init(game_t* game, const game_desc_t* desc) {
     GAME_ASSERT(game && desc);
     if (desc->debug.callback.func) { GAME_ASSERT(desc->debug.stopped); }
     memset(game, 0, sizeof(game_t));
     game->valid = true;
-    game->allocator = desc->allocator;
+    game->host.allocator = desc->allocator;
+    game_buffers_t* buffers = (game_buffers_t*)_game_malloc(game, sizeof(game_buffers_t));
+    memset(buffers, 0, sizeof(game_buffers_t));
+    _game_bind_buffers(game, buffers);
     game->enable_protection = desc->enable_protection;
     game->debug = desc->debug;
     game->part_num = desc->part_num;
@@ -3329,24 +6331,59 @@ void game_init(game_t* game, const game_desc_t* desc) {
     game->audio.callback = desc->audio.callback;
     _game_audio_init(game, desc->audio.callback);
     game->video.use_ega = desc->use_ega;
+    game->host.use_display_list = desc->use_display_list || desc->raster.func || desc->front_to_back || desc->fix_up_palette;
+    game->gfx.fix_up_palette = desc->fix_up_palette;
+    if (game->host.use_display_list) {
+        _game_gfx_lists_init(game);
+    }
+    game->host.front_to_back = desc->front_to_back;
+    game->host.packed = desc->packed_pages && (desc->scale <= 1);
+    game->host.raster = desc->raster;
+    game->host.raster.num_bands = _MAX(1, _MIN(desc->raster.num_bands, GAME_HEIGHT));
+    _game_gfx_reset_rows(game);
+    _game_gfx_bg_reset(game);
+    _game_gfx_init_spans();
+    _game_gfx_init_reciprocal();
+    _game_init_spread();
+    if (desc->scale > 1) {
+        _game_gfx_hires_init(game, _MIN(desc->scale, GAME_MAX_SCALE));
+    }
+    // after the hires pages, the rewind streams keep them, not the pages left blank by no_raster
+    if ((desc->rewind.max_bytes > 0) && !(desc->scene.func && desc->scene.no_raster)) {
+        _game_rewind_init(game, desc->rewind.max_bytes);
+    }
+    if (desc->front_to_back) {
+        _game_gfx_cover_init(game);
+    }
+    if (desc->heatmap) {
+        _game_gfx_heat_init(game);
+    }
+    if (desc->bitmap_cache_bytes > 0) {
+        _game_bitmap_cache_init(game, desc->bitmap_cache_bytes);
+    }
+    if (desc->scene.func) {
+        _game_scene_init(game, &desc->scene);
+    }
 }
 
 void game_start(game_t* game, game_data_t data) {
     GAME_ASSERT(game && game->valid);
-    game->res.data = data;
+    game->host.data = data;
     if (data.demo3_joy.size && game->res.data_type == DT_DOS) {
-        _demo3_joy_read(game, data.demo3_joy.ptr, data.demo3_joy.size);
+        _demo3_joy_read(game, data.demo3_joy.size);
     }
 
     g_debugMask = GAME_DBG_INFO | GAME_DBG_VIDEO | GAME_DBG_SND | GAME_DBG_SCRIPT | GAME_DBG_BANK;
+    _game_strings_init();
+    _game_bitmap_cache_reset(game);
     _game_res_detect_version(game);
     _game_video_init(game);
     game->res.has_password_screen = true;
-    game->res.script_bak_ptr = game->res.script_cur_ptr = game->res.mem;
-    game->res.vid_cur_ptr = game->res.mem + GAME_MEM_BLOCK_SIZE - (GAME_WIDTH * GAME_HEIGHT / 2); // 4bpp bitmap
+    game->res.script_bak_pos = game->res.script_cur_pos = 0;
+    game->res.vid_cur_pos = GAME_MEM_BLOCK_SIZE - (GAME_WIDTH * GAME_HEIGHT / 2); // 4bpp bitmap
     _game_res_read_entries(game);
 
-    _game_gfx_set_work_page_ptr(game, 2);
+    _game_gfx_set_work_page(game, 2);
 
     game->vm.vars[GAME_VAR_RANDOM_SEED] = time(0);
     if(!game->enable_protection) {
@@ -3366,11 +6403,11 @@ void game_start(game_t* game, game_data_t data) {
     case DT_ATARI:
         switch (game->res.lang) {
         case GAME_LANG_FR:
-            game->strings_table = _strings_table_fr;
+            game->host.strings_table = _strings_table_fr;
             break;
         case GAME_LANG_US:
         default:
-            game->strings_table = _strings_table_eng;
+            game->host.strings_table = _strings_table_eng;
             break;
         }
         break;
@@ -3398,7 +6435,7 @@ void game_start(game_t* game, game_data_t data) {
     } else {
         _game_vm_restart_at(game, num, -1);
     }
-    game->title = _game_res_get_game_title(game);
+    game->host.title = _game_res_get_game_title(game);
 }
 
 void game_select_part(game_t* game, int part) {
@@ -3447,38 +6484,86 @@ void game_exec(game_t* game, uint32_t ms) {
     }
 
     game->sleep += 20; // wait 20 ms (50 Hz)
+
+    if (game->host.rewind && !(game->debug.stopped && *game->debug.stopped)) {
+        _game_rewind_capture(game);
+    }
 }
 
 
 void game_cleanup(game_t* game) {
     GAME_ASSERT(game && game->valid);
     _game_audio_stop_all(game);
+    _game_free(game, game->host.buffers);
+    _game_bind_buffers(game, 0);
+    _game_rewind_discard(game);
+    _game_gfx_lists_discard(game);
+    _game_shape_discard(game);
+    _game_gfx_hires_discard(game);
+    _game_gfx_cover_discard(game);
+    _game_gfx_heat_discard(game);
+    _game_bitmap_cache_discard(game);
+    _game_gfx_bg_discard(game);
+    _game_scene_discard(game);
+    game->valid = false;
 }
 
 gfx_display_info_t game_display_info(game_t* game) {
     GAME_ASSERT(game && game->valid);
+    const game_gfx_background_t* bg = game->host.background;
+    if (bg && bg->frame) {
+        // true color frame, see _game_gfx_bg_present()
+        const gfx_display_info_t res = {
+            .frame = {
+                .dim = {
+                    .width = bg->frame_width,
+                    .height = bg->frame_height,
+                },
+                .buffer = {
+                    .ptr = (void*)bg->frame,
+                    .size = (size_t)bg->frame_width * bg->frame_height * sizeof(uint32_t),
+                },
+                .bytes_per_pixel = 4
+            },
+            .screen = {
+                .x = 0,
+                .y = 0,
+                .width = bg->frame_width,
+                .height = bg->frame_height,
+            },
+        };
+        return res;
+    }
+    const int scale = game->host.hires ? game->host.hires->scale : 1;
+    int width, height;
+    uint8_t* fb = _game_gfx_presented_pixels(game, &width, &height);
     const gfx_display_info_t res = {
         .frame = {
             .dim = {
-                .width = GAME_WIDTH,
-                .height = GAME_HEIGHT,
+                .width = width,
+                .height = height,
             },
             .buffer = {
-                .ptr = game->gfx.fb,
-                .size = GAME_WIDTH*GAME_HEIGHT,
+                .ptr = fb,
+                .size = (size_t)width * height,
             },
             .bytes_per_pixel = 1
         },
         .screen = {
             .x = 0,
             .y = 0,
-            .width = GAME_WIDTH,
-            .height = GAME_HEIGHT,
+            .width = width,
+            .height = height,
         },
         .palette = {
             .ptr = game->gfx.palette,
             .size = 1024,
-        }
+        },
+        .dirty = {
+            .valid = true,
+            .y = game->gfx.fb_dirty.top * scale,
+            .height = _MAX(game->gfx.fb_dirty.bottom - game->gfx.fb_dirty.top + 1, 0) * scale,
+        },
     };
     return res;
 }
@@ -3516,6 +6601,12 @@ void game_char_pressed(game_t* game, int c) {
     game->input.last_char = (char)c;
 }
 
+void game_decode_bitmap(const game_t* game, const uint8_t* src, uint8_t* dst) {
+    GAME_ASSERT(game && game->valid && src && dst);
+    _game_init_spread();
+    _game_decode_planar(game->res.data_type, src, dst, false);
+}
+
 bool game_get_res_buf(game_t* game, int id, uint8_t* dst) {
     GAME_ASSERT(game && game->valid);
     game_mem_entry_t* me = &game->res.mem_list[id];
@@ -3544,34 +6635,627 @@ void game_debug_snapshot_onload(game_debug_t* snapshot, game_debug_t* sys) {
     snapshot->stopped = sys->stopped;
 }
 
-bool game_load_snapshot(game_t* game, uint32_t version, game_t* src) {
-    GAME_ASSERT(game && src);
-    if (version != GAME_SNAPSHOT_VERSION) {
+/*
+    Snapshot stream layout (host byte order):
+
+    "RAWS", version, game state size, used resource memory size,
+    optional sections (_GAME_SNAPSHOT_LISTS | _GAME_SNAPSHOT_HIRES)  5 x uint32_t
+    game_t up to game_t.host, without the buffer pointers       game state size
+    resource memory up to res.script_cur_pos                   used size
+    4 pages and the frame buffer, each one mode byte followed by either the
+    pixels 4-bit packed (_GAME_SNAPSHOT_PAGE_PACKED) or raw (_GAME_SNAPSHOT_PAGE_RAW)
+    with _GAME_SNAPSHOT_LISTS, the draw commands still recorded on the 4 pages,
+    each as num_cmds and data_size (uint16_t), reads_page0 (uint8_t), the
+    commands and the polygon data, see _game_snapshot_write_lists()
+    with _GAME_SNAPSHOT_HIRES, the scale (uint8_t) and the 4 high resolution
+    pages and frame buffer, each one mode byte followed by the pixels XOR'ed
+    with the upscaled 320x200 ones, see _game_snapshot_write_hires_page()
+
+    game_save_snapshot() rasterizes the recorded commands into the pages and
+    writes no commands, the rewind captures write them as they are so that
+    recording a frame doesn't rasterize the pages (see game_desc_t.use_display_list).
+    The rewind captures also keep the high resolution pages, the pages of a
+    stream without them are upscaled from the 320x200 ones (see game_desc_t.scale).
+
+    The audio mix buffers and the bitmap scratch area at res.vid_cur_pos are
+    transient and not written.
+*/
+
+static uint8_t* _game_snapshot_page(game_t* game, int i) {
+    // the last page holds the displayed image
+    if (i == 4) {
+        i = game->gfx.presented;
+    }
+    return (i < 4) ? game->gfx.fbs[i].buffer : game->gfx.fb;
+}
+
+// packed is true for the pages of game_desc_t.packed_pages, which are stored as they are
+static uint8_t* _game_snapshot_write_page(uint8_t* dst, const uint8_t* page, bool packed) {
+    if (packed) {
+        *dst++ = _GAME_SNAPSHOT_PAGE_PACKED;
+        memcpy(dst, page, _GAME_SNAPSHOT_PAGE_SIZE / 2);
+        return dst + _GAME_SNAPSHOT_PAGE_SIZE / 2;
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < _GAME_SNAPSHOT_PAGE_SIZE; i += 8) {
+        uint64_t v;
+        memcpy(&v, page + i, 8);
+        bits |= v;
+    }
+    if (bits & 0xF0F0F0F0F0F0F0F0ULL) {
+        *dst++ = _GAME_SNAPSHOT_PAGE_RAW;
+        memcpy(dst, page, _GAME_SNAPSHOT_PAGE_SIZE);
+        return dst + _GAME_SNAPSHOT_PAGE_SIZE;
+    }
+    *dst++ = _GAME_SNAPSHOT_PAGE_PACKED;
+    _game_packed_pack(dst, page, _GAME_SNAPSHOT_PAGE_SIZE / 2);
+    return dst + _GAME_SNAPSHOT_PAGE_SIZE / 2;
+}
+
+// the size pixels of a solid page, like the page written by _game_snapshot_write_page() once it is filled
+static uint8_t* _game_snapshot_write_solid(uint8_t* dst, uint8_t color, size_t size, bool packed) {
+    if ((color & 0xF0) && !packed) {
+        *dst++ = _GAME_SNAPSHOT_PAGE_RAW;
+        memset(dst, color, size);
+        return dst + size;
+    }
+    *dst++ = _GAME_SNAPSHOT_PAGE_PACKED;
+    memset(dst, (color & 0xF) * 0x11, size / 2);
+    return dst + size / 2;
+}
+
+// write the snapshot page i as it reads, a lazy page is taken from its color or source page and stays lazy
+static uint8_t* _game_snapshot_save_page(uint8_t* dst, game_t* game, int i) {
+    const bool packed = game->host.packed && (i < 4);
+    if (i < 4) {
+        const int src = _game_gfx_page_pixels(game, i);
+        if (src < 0) {
+            return _game_snapshot_write_solid(dst, game->gfx.lazy[i].color, _GAME_SNAPSHOT_PAGE_SIZE, packed);
+        }
+        i = src;
+    }
+    return _game_snapshot_write_page(dst, _game_snapshot_page(game, i), packed);
+}
+
+// the high resolution pixels of the snapshot page i
+static uint8_t* _game_snapshot_hires_page(game_t* game, int i) {
+    const game_hires_t* hr = game->host.hires;
+    if (i == 4) {
+        i = game->gfx.presented;
+    }
+    return (i < 4) ? hr->fbs[i] : hr->fb;
+}
+
+// a row of a 320x200 page upscaled to the width of the high resolution pages
+static void _game_snapshot_hires_row(uint8_t* dst, const uint8_t* row, int scale) {
+    for (int x = 0; x < GAME_WIDTH; x++) {
+        memset(dst, row[x], scale);
+        dst += scale;
+    }
+}
+
+// dst = a ^ b for n bytes, n a multiple of 8, returns the bits set in dst
+static uint64_t _game_snapshot_xor(uint8_t* dst, const uint8_t* a, const uint8_t* b, size_t n) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < n; i += 8) {
+        uint64_t va, vb;
+        memcpy(&va, a + i, 8);
+        memcpy(&vb, b + i, 8);
+        va ^= vb;
+        memcpy(dst + i, &va, 8);
+        bits |= va;
+    }
+    return bits;
+}
+
+/*
+    A high resolution page is written as the XOR of its pixels with the
+    nearest neighbour upscaling of its 320x200 page, which the stream holds
+    already: it is 0 but along the edges of the polygons, so the pages pack
+    to 4 bits and the rewind deltas stay close to the ones of the 320x200
+    pages.
+*/
+static uint8_t* _game_snapshot_write_hires_page(uint8_t* dst, const game_hires_t* hr, const uint8_t* hires, const uint8_t* page) {
+    const size_t size = (size_t)hr->width * hr->height;
+    uint8_t* pixels = dst + 1;
+    uint8_t up[GAME_WIDTH * GAME_MAX_SCALE];
+    uint8_t row[GAME_WIDTH * GAME_MAX_SCALE];
+    uint64_t bits = 0;
+    *dst = _GAME_SNAPSHOT_PAGE_PACKED;
+    for (int y = 0; (y < hr->height) && !(bits & 0xF0F0F0F0F0F0F0F0ULL); y++) {
+        if ((y % hr->scale) == 0) {
+            _game_snapshot_hires_row(up, page + (y / hr->scale) * GAME_WIDTH, hr->scale);
+        }
+        bits |= _game_snapshot_xor(row, hires + (size_t)y * hr->width, up, hr->width);
+        _game_packed_pack(pixels + (size_t)y * hr->width / 2, row, hr->width / 2);
+    }
+    if (!(bits & 0xF0F0F0F0F0F0F0F0ULL)) {
+        return pixels + size / 2;
+    }
+    *dst = _GAME_SNAPSHOT_PAGE_RAW;
+    for (int y = 0; y < hr->height; y++) {
+        if ((y % hr->scale) == 0) {
+            _game_snapshot_hires_row(up, page + (y / hr->scale) * GAME_WIDTH, hr->scale);
+        }
+        _game_snapshot_xor(pixels + (size_t)y * hr->width, hires + (size_t)y * hr->width, up, hr->width);
+    }
+    return pixels + size;
+}
+
+// XOR the high resolution page read from a stream with the upscaled 320x200 page again
+static void _game_snapshot_read_hires_page(const game_hires_t* hr, uint8_t* hires, const uint8_t* page) {
+    uint8_t up[GAME_WIDTH * GAME_MAX_SCALE];
+    for (int y = 0; y < hr->height; y++) {
+        if ((y % hr->scale) == 0) {
+            _game_snapshot_hires_row(up, page + (y / hr->scale) * GAME_WIDTH, hr->scale);
+        }
+        _game_snapshot_xor(hires + (size_t)y * hr->width, hires + (size_t)y * hr->width, up, hr->width);
+    }
+}
+
+// the high resolution pages in the order of the 320x200 ones, see _game_snapshot_save_page()
+static uint8_t* _game_snapshot_write_hires(uint8_t* dst, game_t* game) {
+    const game_hires_t* hr = game->host.hires;
+    *dst++ = (uint8_t)hr->scale;
+    for (int i = 0; i < _GAME_SNAPSHOT_NUM_PAGES; i++) {
+        int page = i;
+        if (i < 4) {
+            page = _game_gfx_page_pixels(game, i);
+            if (page < 0) {
+                // filled like the 320x200 page
+                dst = _game_snapshot_write_solid(dst, 0, (size_t)hr->width * hr->height, false);
+                continue;
+            }
+        }
+        dst = _game_snapshot_write_hires_page(dst, hr, _game_snapshot_hires_page(game, page), _game_snapshot_page(game, page));
+    }
+    return dst;
+}
+
+// the commands recorded on the pages, without rasterizing them
+static uint8_t* _game_snapshot_write_lists(uint8_t* dst, const game_t* game) {
+    for (int i = 0; i < 4; i++) {
+        const game_gfx_list_t* list = &game->host.lists[i];
+        memcpy(dst, &list->num_cmds, 2);
+        memcpy(dst + 2, &list->data_size, 2);
+        dst[4] = list->reads_page0 ? 1 : 0;
+        dst += 5;
+        memcpy(dst, list->cmds, list->num_cmds * sizeof(game_gfx_cmd_t));
+        dst += list->num_cmds * sizeof(game_gfx_cmd_t);
+        memcpy(dst, list->data, list->data_size);
+        dst += list->data_size;
+    }
+    return dst;
+}
+
+// size of the commands written by _game_snapshot_write_lists() at src, 0 if they are invalid
+static size_t _game_snapshot_lists_size(const uint8_t* src, size_t src_size) {
+    size_t pos = 0;
+    for (int i = 0; i < 4; i++) {
+        if ((src_size - pos) < 5) {
+            return 0;
+        }
+        uint16_t num_cmds, data_size;
+        memcpy(&num_cmds, src + pos, 2);
+        memcpy(&data_size, src + pos + 2, 2);
+        pos += 5;
+        if ((num_cmds > GAME_GFX_MAX_CMDS) || (data_size > GAME_GFX_MAX_DATA) || ((src_size - pos) < (num_cmds * sizeof(game_gfx_cmd_t) + data_size))) {
+            return 0;
+        }
+        const uint8_t* data = src + pos + num_cmds * sizeof(game_gfx_cmd_t);
+        for (int j = 0; j < num_cmds; j++) {
+            game_gfx_cmd_t cmd;
+            memcpy(&cmd, src + pos + j * sizeof(game_gfx_cmd_t), sizeof(cmd));
+            switch (cmd.type) {
+            case GAME_GFX_CMD_FILL:
+                break;
+            case GAME_GFX_CMD_POLYGON:
+                if (((cmd.data + 3) > data_size) || (data[cmd.data + 2] >= GAME_QUAD_STRIP_MAX_VERTICES) || ((cmd.data + 3 + data[cmd.data + 2] * 2) > data_size)) {
+                    return 0;
+                }
+                break;
+            case GAME_GFX_CMD_CHAR:
+                if ((cmd.data < 0x20) || (cmd.data >= (0x20 + sizeof(_font) / 8))) {
+                    return 0;
+                }
+                break;
+            default:
+                return 0;
+            }
+        }
+        pos += num_cmds * sizeof(game_gfx_cmd_t) + data_size;
+    }
+    return pos;
+}
+
+static const uint8_t* _game_snapshot_read_lists(const uint8_t* src, game_t* game) {
+    for (int i = 0; i < 4; i++) {
+        game_gfx_list_t* list = &game->host.lists[i];
+        memcpy(&list->num_cmds, src, 2);
+        memcpy(&list->data_size, src + 2, 2);
+        list->reads_page0 = (src[4] != 0);
+        src += 5;
+        memcpy(list->cmds, src, list->num_cmds * sizeof(game_gfx_cmd_t));
+        src += list->num_cmds * sizeof(game_gfx_cmd_t);
+        memcpy(list->data, src, list->data_size);
+        src += list->data_size;
+    }
+    return src;
+}
+
+static const uint8_t* _game_snapshot_read_page(const uint8_t* src, uint8_t* page, size_t size, bool packed) {
+    if (*src++ == _GAME_SNAPSHOT_PAGE_RAW) {
+        if (packed) {
+            _game_packed_pack(page, src, size / 2);
+        } else {
+            memcpy(page, src, size);
+        }
+        return src + size;
+    }
+    if (packed) {
+        memcpy(page, src, size / 2);
+    } else {
+        _game_packed_expand(page, src, size / 2);
+    }
+    return src + size / 2;
+}
+
+// size of the num pages of size pixels at src, 0 if they don't fit in src_size
+static size_t _game_snapshot_pages_size(const uint8_t* src, size_t src_size, int num, size_t size) {
+    size_t pos = 0;
+    for (int i = 0; i < num; i++) {
+        if (pos >= src_size) {
+            return 0;
+        }
+        pos += 1 + ((src[pos] == _GAME_SNAPSHOT_PAGE_RAW) ? size : size / 2);
+    }
+    return (pos <= src_size) ? pos : 0;
+}
+
+// decode again the RGB bitmaps the pages refer to which aren't decoded, after loading a snapshot
+static void _game_gfx_bg_restore(game_t* game) {
+    for (int i = 0; i < 5; i++) {
+        const uint16_t res_num = game->gfx.bg_res[i];
+        if ((res_num == GAME_GFX_NO_BACKGROUND) || _game_gfx_bg_find(game, res_num)) {
+            continue;
+        }
+        // read aside, the resource memory holds the restored state
+        game_mem_entry_t* me = &game->res.mem_list[res_num];
+        uint8_t* src = (uint8_t*)_game_malloc(game, _MAX(me->unpacked_size, me->packed_size) + 1);
+        int w, h;
+        uint8_t* rgb = (me->bank_num > 0) && _game_res_read_bank(game, me, src) ? _decode_bitmap(game, src, &w, &h) : 0;
+        _game_free(game, src);
+        if (rgb) {
+            _game_gfx_bg_add(game, i, res_num, rgb, w, h);
+            _game_free(game, rgb);
+        } else {
+            game->gfx.bg_res[i] = GAME_GFX_NO_BACKGROUND;
+        }
+    }
+    _game_gfx_bg_present(game, _GAME_GFX_FB);
+}
+
+// true when the range of size bytes at pos lies in the resource memory
+static bool _game_snapshot_in_mem(uint32_t pos, uint32_t size, uint32_t mem_size) {
+    return (pos <= mem_size) && (size <= (mem_size - pos));
+}
+
+/*
+    Check the state read from a snapshot before it replaces the running game:
+    every offset into res.mem has to stay in the memory the stream restores
+    (or in the memory block for the bitmaps and the sounds it reads from), the
+    indexes in their tables, and the resource table has to be the one of the
+    running game's data so that the resources still load from its banks.
+*/
+static bool _game_snapshot_valid(const game_t* im, const game_t* game, uint32_t mem_size) {
+    const game_res_t* res = &im->res;
+    if ((res->data_type != game->res.data_type) || (res->num_mem_list != game->res.num_mem_list) || (res->num_mem_list > GAME_ENTRIES_COUNT_20TH)) {
+        return false;
+    }
+    for (int i = 0; i < res->num_mem_list; i++) {
+        const game_mem_entry_t* me = &res->mem_list[i];
+        const game_mem_entry_t* sys = &game->res.mem_list[i];
+        if ((me->type != sys->type) || (me->rank_num != sys->rank_num) || (me->bank_num != sys->bank_num) || (me->bank_pos != sys->bank_pos) ||
+            (me->packed_size != sys->packed_size) || (me->unpacked_size != sys->unpacked_size)) {
+            return false;
+        }
+        if ((me->status == GAME_RES_STATUS_LOADED) && !_game_snapshot_in_mem(me->buf_pos, me->unpacked_size, GAME_MEM_BLOCK_SIZE)) {
+            return false;
+        }
+    }
+    if ((res->script_bak_pos > mem_size) || (res->vid_cur_pos < mem_size) || (res->vid_cur_pos > GAME_MEM_BLOCK_SIZE)) {
+        return false;
+    }
+    if (((res->current_part != 0) && ((res->current_part < 16000) || (res->current_part > 16009))) ||
+        ((res->next_part != 0) && ((res->next_part < 16000) || (res->next_part > 16009)))) {
+        return false;
+    }
+    if (!_game_snapshot_in_mem(res->seg_code, res->seg_code_size, mem_size) || (res->seg_video_pal > mem_size) ||
+        (res->seg_video1 > mem_size) || (res->seg_video2 > mem_size)) {
+        return false;
+    }
+    // the segments are the resources of the current part, as _game_res_setup_part() sets them
+    if (res->current_part != 0) {
+        const uint8_t* ids = _mem_list_parts[res->current_part - 16000];
+        if ((res->seg_video_pal != res->mem_list[ids[0]].buf_pos) || (res->seg_code != res->mem_list[ids[1]].buf_pos) ||
+            (res->seg_code_size != res->mem_list[ids[1]].unpacked_size) || (res->seg_video1 != res->mem_list[ids[2]].buf_pos) ||
+            ((ids[3] != 0) && (res->seg_video2 != res->mem_list[ids[3]].buf_pos))) {
+            return false;
+        }
+    }
+    if ((im->video.data_buf != 0) && (im->video.data_buf != res->seg_video1) && (im->video.data_buf != res->seg_video2)) {
+        return false;
+    }
+    // the VM, its code offsets are relative to res.seg_code
+    if ((im->vm.ptr.pc < res->seg_code) || ((im->vm.ptr.pc - res->seg_code) > res->seg_code_size) ||
+        (im->vm.stack_ptr > 64) || (im->vm.current_task >= GAME_NUM_TASKS)) {
+        return false;
+    }
+    for (int i = 0; i < im->vm.stack_ptr; i++) {
+        if (im->vm.stack_calls[i] > res->seg_code_size) {
+            return false;
+        }
+    }
+    for (int i = 0; i < GAME_NUM_TASKS; i++) {
+        const uint16_t pc = im->vm.tasks[i].pc;
+        const uint16_t next_pc = im->vm.tasks[i].next_pc;
+        if (((pc != _GAME_INACTIVE_TASK) && (pc >= res->seg_code_size)) ||
+            ((next_pc < _GAME_INACTIVE_TASK - 1) && (next_pc >= res->seg_code_size))) {
+            return false;
+        }
+    }
+    if (im->input.demo_joy.buf_size > game->host.data.demo3_joy.size) {
+        return false;
+    }
+    // the video and its pages
+    if ((im->video.current_pal >= 32 && im->video.current_pal != 0xFF) || (im->video.next_pal >= 32 && im->video.next_pal != 0xFF) ||
+        (im->video.buffers[0] > 3) || (im->video.buffers[1] > 3) || (im->video.buffers[2] > 3) ||
+        (im->video.data_buf > mem_size) || (im->video.p_data.pc > mem_size)) {
+        return false;
+    }
+    if ((im->gfx.draw_page > 3) || (im->gfx.presented < 0) || (im->gfx.presented > 4)) {
+        return false;
+    }
+    for (int i = 0; i < 5; i++) {
+        const uint16_t bg_res = im->gfx.bg_res[i];
+        if ((bg_res != GAME_GFX_NO_BACKGROUND) && ((bg_res >= res->num_mem_list) || (res->mem_list[bg_res].type != RT_BITMAP))) {
+            return false;
+        }
+    }
+    // the sounds read up to the end of their loop
+    for (int i = 0; i < GAME_MIX_CHANNELS; i++) {
+        const game_audio_channel_t* chan = &im->audio.channels[i];
+        if (chan->data && !_game_snapshot_in_mem(chan->data, _MAX(chan->len, chan->loop_pos + chan->loop_len), GAME_MEM_BLOCK_SIZE)) {
+            return false;
+        }
+    }
+    const game_audio_sfx_player_t* player = &im->audio.sfx_player;
+    const game_audio_sfx_module_t* mod = &player->sfx_mod;
+    if (mod->data || mod->order_table) {
+        if (!_game_snapshot_in_mem(mod->order_table, 0x80, mem_size) || !_game_snapshot_in_mem(mod->data, 1024, mem_size) || (mod->cur_order >= 0x80) || (mod->cur_pos >= 1024)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < 15; i++) {
+        if (mod->samples[i].data && !_game_snapshot_in_mem(mod->samples[i].data, 8, mem_size)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < GAME_SFX_NUM_CHANNELS; i++) {
+        const game_audio_sfx_channel_t* ch = &player->channels[i];
+        const uint32_t end = _MAX(ch->sample_len, ch->sample_loop_pos + ch->sample_loop_len);
+        if (ch->sample_len && (!_game_snapshot_in_mem(ch->sample_data, end + 1, GAME_MEM_BLOCK_SIZE) || ((ch->pos.offset >> _GAME_FRAC_BITS) >= end))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool game_load_snapshot(game_t* game, const uint8_t* src, size_t src_size) {
+    GAME_ASSERT(game && game->valid && game->host.buffers && src);
+    if ((src_size < _GAME_SNAPSHOT_HEADER_SIZE) || _game_scene_no_raster(game)) {
+        return false;
+    }
+    uint32_t header[5];
+    memcpy(header, src, sizeof(header));
+    const uint32_t mem_size = header[3];
+    const uint32_t sections = header[4];
+    if ((header[0] != _GAME_SNAPSHOT_MAGIC) || (header[1] != GAME_SNAPSHOT_VERSION) || (header[2] != _GAME_SNAPSHOT_STATE_SIZE) || (mem_size > GAME_MEM_BLOCK_SIZE)) {
+        return false;
+    }
+    if (sections & ~(uint32_t)(_GAME_SNAPSHOT_LISTS | _GAME_SNAPSHOT_HIRES)) {
+        return false;
+    }
+    // validate the whole stream before touching the running game
+    size_t pos = _GAME_SNAPSHOT_HEADER_SIZE + _GAME_SNAPSHOT_STATE_SIZE + mem_size;
+    if (pos > src_size) {
+        return false;
+    }
+    size_t size = _game_snapshot_pages_size(src + pos, src_size - pos, _GAME_SNAPSHOT_NUM_PAGES, _GAME_SNAPSHOT_PAGE_SIZE);
+    if (size == 0) {
+        return false;
+    }
+    pos += size;
+    // the recorded commands can only be restored by a game recording them
+    const bool lists = (sections & _GAME_SNAPSHOT_LISTS) != 0;
+    if (lists) {
+        size = game->host.use_display_list ? _game_snapshot_lists_size(src + pos, src_size - pos) : 0;
+        if (size == 0) {
+            return false;
+        }
+        pos += size;
+    }
+    // the high resolution pages are kept when they have the scale of the running game
+    const game_hires_t* hr = game->host.hires;
+    size_t hires_pos = 0;
+    if (sections & _GAME_SNAPSHOT_HIRES) {
+        if ((pos >= src_size) || (src[pos] < 2) || (src[pos] > GAME_MAX_SCALE)) {
+            return false;
+        }
+        const size_t hires_size = (size_t)_GAME_SNAPSHOT_PAGE_SIZE * src[pos] * src[pos];
+        size = _game_snapshot_pages_size(src + pos + 1, src_size - pos - 1, _GAME_SNAPSHOT_NUM_PAGES, hires_size);
+        if (size == 0) {
+            return false;
+        }
+        if (hr && (hr->scale == src[pos])) {
+            hires_pos = pos + 1;
+        }
+        pos += 1 + size;
+    }
+    if (pos != src_size) {
         return false;
     }
     static game_t im;
-    im = *src;
+    memcpy(&im, src + _GAME_SNAPSHOT_HEADER_SIZE, _GAME_SNAPSHOT_STATE_SIZE);
+    if ((im.res.script_cur_pos != mem_size) || !_game_snapshot_valid(&im, game, mem_size)) {
+        return false;
+    }
+    im.valid = true;
     game_debug_snapshot_onload(&im.debug, &game->debug);
     game_audio_callback_snapshot_onload(&im.audio.callback, &game->audio.callback);
+    // the host state isn't in the stream, keep the one of the running game
+    im.host = game->host;
+    im.gfx.fix_up_palette = game->gfx.fix_up_palette;
+    _game_bind_buffers(&im, game->host.buffers);
+    _game_gfx_reset_rows(&im);
+    memset(im.gfx.lazy, 0, sizeof(im.gfx.lazy));
+    _game_shape_reset(&im);
+    const uint8_t* ptr = src + _GAME_SNAPSHOT_HEADER_SIZE + _GAME_SNAPSHOT_STATE_SIZE;
+    memcpy(im.res.mem, ptr, mem_size);
+    ptr += mem_size;
+    for (int i = 0; i < _GAME_SNAPSHOT_NUM_PAGES; i++) {
+        ptr = _game_snapshot_read_page(ptr, _game_snapshot_page(&im, i), _GAME_SNAPSHOT_PAGE_SIZE, im.host.packed && (i < 4));
+    }
+    // the pages are overwritten, the commands recorded on them are the ones of the stream
+    if (lists) {
+        ptr = _game_snapshot_read_lists(ptr, &im);
+    } else if (im.host.use_display_list) {
+        for (int i = 0; i < 4; i++) {
+            _game_gfx_reset_list(&im, i);
+        }
+    }
+    if (hires_pos > 0) {
+        ptr = src + hires_pos;
+        for (int i = 0; i < _GAME_SNAPSHOT_NUM_PAGES; i++) {
+            uint8_t* hires = _game_snapshot_hires_page(&im, i);
+            const uint8_t* page = _game_snapshot_page(&im, i);
+            ptr = _game_snapshot_read_page(ptr, hires, (size_t)hr->width * hr->height, false);
+            _game_snapshot_read_hires_page(hr, hires, page);
+        }
+    } else {
+        _game_gfx_hires_sync(&im);
+    }
     *game = im;
+    _game_gfx_bg_restore(game);
+    _game_scene_restart(game);
     return true;
 }
 
-uint32_t game_save_snapshot(game_t* game, game_t* dst) {
-    GAME_ASSERT(game && dst);
-    *dst = *game;
-    game_debug_snapshot_onsave(&dst->debug);
-    game_audio_callback_snapshot_onsave(&dst->audio.callback);
-    return GAME_SNAPSHOT_VERSION;
+// sections are the optional parts written, with _GAME_SNAPSHOT_LISTS the recorded
+// commands are written after the pages instead of being rasterized
+static size_t _game_snapshot_save(game_t* game, uint8_t* dst, size_t dst_size, uint32_t sections) {
+    const bool lists = (sections & _GAME_SNAPSHOT_LISTS) && game->host.use_display_list;
+    const bool hires = (sections & _GAME_SNAPSHOT_HIRES) && game->host.hires;
+    const uint32_t mem_size = game->res.script_cur_pos;
+    const size_t max_lists_size = lists ? 4 * sizeof(game_gfx_list_t) : 0;
+    const size_t max_hires_size = hires ? _GAME_SNAPSHOT_HIRES_SIZE(game->host.hires->scale) : 0;
+    if (dst_size < (_GAME_SNAPSHOT_HEADER_SIZE + _GAME_SNAPSHOT_STATE_SIZE + mem_size + _GAME_SNAPSHOT_NUM_PAGES * (1 + _GAME_SNAPSHOT_PAGE_SIZE) + max_lists_size + max_hires_size)) {
+        return 0;
+    }
+    const uint32_t header[5] = { _GAME_SNAPSHOT_MAGIC, GAME_SNAPSHOT_VERSION, _GAME_SNAPSHOT_STATE_SIZE, mem_size, (lists ? _GAME_SNAPSHOT_LISTS : 0) | (hires ? _GAME_SNAPSHOT_HIRES : 0) };
+    memcpy(dst, header, sizeof(header));
+    uint8_t* ptr = dst + _GAME_SNAPSHOT_HEADER_SIZE;
+    if (!lists && game->host.use_display_list) {
+        // the pending draws have to be rasterized to be written
+        for (int i = 0; i < 4; i++) {
+            _game_gfx_resolve(game, i);
+        }
+    }
+    // clear everything that points into host memory so equal states give equal streams
+    static game_t im;
+    memcpy(&im, game, _GAME_SNAPSHOT_STATE_SIZE);
+    game_debug_snapshot_onsave(&im.debug);
+    game_audio_callback_snapshot_onsave(&im.audio.callback);
+    _game_bind_buffers(&im, 0);
+    // the page state is rebuilt on load, the written pages are what it describes
+    memset(im.gfx.lazy, 0, sizeof(im.gfx.lazy));
+    _game_gfx_reset_rows(&im);
+    memcpy(ptr, &im, _GAME_SNAPSHOT_STATE_SIZE);
+    ptr += _GAME_SNAPSHOT_STATE_SIZE;
+    memcpy(ptr, game->res.mem, mem_size);
+    ptr += mem_size;
+    for (int i = 0; i < _GAME_SNAPSHOT_NUM_PAGES; i++) {
+        ptr = _game_snapshot_save_page(ptr, game, i);
+    }
+    if (lists) {
+        ptr = _game_snapshot_write_lists(ptr, game);
+    }
+    if (hires) {
+        ptr = _game_snapshot_write_hires(ptr, game);
+    }
+    return (size_t)(ptr - dst);
+}
+
+size_t game_save_snapshot(game_t* game, uint8_t* dst, size_t dst_size) {
+    GAME_ASSERT(game && game->valid && dst);
+    if (_game_scene_no_raster(game)) {
+        return 0;
+    }
+    return _game_snapshot_save(game, dst, dst_size, 0);
+}
+
+uint32_t game_rewind(game_t* game, uint32_t frames) {
+    GAME_ASSERT(game && game->valid);
+    game_rewind_t* rw = game->host.rewind;
+    if (!rw || (rw->cur_size == 0)) {
+        return 0;
+    }
+    frames = _MIN(frames, rw->num_frames);
+    for (uint32_t i = 0; i < frames; i++) {
+        const game_rewind_frame_t* frame = &rw->frames[(rw->first + rw->num_frames - 1) % GAME_REWIND_MAX_FRAMES];
+        _game_rewind_apply(rw->cur, rw->buf + frame->pos, frame->size);
+        rw->cur_size = frame->stream_size;
+        rw->cur_elapsed = frame->elapsed;
+        rw->head = frame->pos;
+        rw->num_frames--;
+    }
+    if (frames > 0) {
+        // keep the keys currently held down by the player
+        const uint8_t dir_mask = game->input.dir_mask;
+        const bool action = game->input.action;
+        game_load_snapshot(game, rw->cur, rw->cur_size);
+        game->input.dir_mask = dir_mask;
+        game->input.action = action;
+    }
+    return frames;
+}
+
+uint32_t game_rewind_time(game_t* game, uint32_t ms) {
+    GAME_ASSERT(game && game->valid);
+    const game_rewind_t* rw = game->host.rewind;
+    if (!rw) {
+        return 0;
+    }
+    // the VM frames don't last the same time, count the ones back to the first frame old enough
+    uint32_t frames = 0;
+    while (frames < rw->num_frames) {
+        const game_rewind_frame_t* frame = &rw->frames[(rw->first + rw->num_frames - 1 - frames) % GAME_REWIND_MAX_FRAMES];
+        frames++;
+        if ((game->elapsed - frame->elapsed) >= ms) {
+            break;
+        }
+    }
+    return game_rewind(game, frames);
+}
+
+uint32_t game_rewind_num_frames(const game_t* game) {
+    GAME_ASSERT(game && game->valid);
+    return game->host.rewind ? game->host.rewind->num_frames : 0;
 }
 
 const char* game_get_string(game_t* game, uint16_t id) {
-   for (const game_str_entry_t *se = game->strings_table; se->id != 0xFFFF; ++se) {
-     if (se->id == id) {
-         return se->str;
-     }
-   }
-   return "???";
+    const char* str = _find_string(game->host.strings_table, id);
+    return str ? str : "???";
 }
 
 bool game_part_exists(const game_t* game, int part) {
@@ -3582,10 +7266,10 @@ bool game_part_exists(const game_t* game, int part) {
         uint8_t ivd1 = _mem_list_parts[id][2];
         uint8_t ivd2 = _mem_list_parts[id][3];
 
-        if(!game->res.mem_list[ipal].bank_num || game->res.data.banks[game->res.mem_list[ipal].bank_num-1].size == 0 ||
-           !game->res.mem_list[icod].bank_num || game->res.data.banks[game->res.mem_list[icod].bank_num-1].size == 0 ||
-           !game->res.mem_list[ivd1].bank_num || game->res.data.banks[game->res.mem_list[ivd1].bank_num-1].size == 0 ||
-           !game->res.mem_list[ivd2].bank_num || game->res.data.banks[game->res.mem_list[ivd2].bank_num-1].size == 0)
+        if(!game->res.mem_list[ipal].bank_num || game->host.data.banks[game->res.mem_list[ipal].bank_num-1].size == 0 ||
+           !game->res.mem_list[icod].bank_num || game->host.data.banks[game->res.mem_list[icod].bank_num-1].size == 0 ||
+           !game->res.mem_list[ivd1].bank_num || game->host.data.banks[game->res.mem_list[ivd1].bank_num-1].size == 0 ||
+           !game->res.mem_list[ivd2].bank_num || game->host.data.banks[game->res.mem_list[ivd2].bank_num-1].size == 0)
             return false;
 
         return true;
@@ -3596,8 +7280,8 @@ bool game_part_exists(const game_t* game, int part) {
 static void* _game_malloc(game_t* game, size_t size) {
     GAME_ASSERT(size > 0);
     void* ptr;
-    if (game->allocator.alloc_fn) {
-        ptr = game->allocator.alloc_fn(size, game->allocator.user_data);
+    if (game->host.allocator.alloc_fn) {
+        ptr = game->host.allocator.alloc_fn(size, game->host.allocator.user_data);
     } else {
         ptr = malloc(size);
     }
@@ -3608,8 +7292,8 @@ static void* _game_malloc(game_t* game, size_t size) {
 }
 
 static void _game_free(game_t* game, void* ptr) {
-    if (game->allocator.free_fn) {
-        game->allocator.free_fn(ptr, game->allocator.user_data);
+    if (game->host.allocator.free_fn) {
+        game->host.allocator.free_fn(ptr, game->host.allocator.user_data);
     }
     else {
         free(ptr);
@@ -3,6 +3,7 @@
 
     Another world rewrite with sokol.
 */
+#include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -19,6 +20,8 @@
 #include "game.h"
 #include "miniz.h"
 #include "fs.h"
+#include "worker.h"
+#include "pool.h"
 #if defined(GAME_USE_UI)
     #include "ui/ui_util.h"
     #include "ui.h"
@@ -30,16 +33,40 @@
     #include "ui/ui_game.h"
 #endif
 
+#define REWIND_HISTORY_SIZE (8 * 1024 * 1024)
+#define BITMAP_CACHE_SIZE (1024 * 1024)
+#define SNAPSHOT_SAVE_QUEUE_SIZE (4)
+
+// a snapshot slot holds the miniz compressed stream written by game_save_snapshot()
 typedef struct {
-    uint32_t    version;
-    game_t      game;
+    uint8_t*        data;
+    size_t          size;
 } game_snapshot_t;
 
+#ifdef GAME_USE_UI
+// a snapshot save captured on the frame thread, compressed and written by the worker
+// (written on the frame thread with emscripten, see ui_save_snapshot_done())
+typedef struct {
+    size_t          slot;
+    ui_snapshot_screenshot_t screenshot;
+    uint8_t*        stream;         // uncompressed snapshot stream
+    size_t          stream_size;
+    uint8_t*        data;           // compressed stream, 0 if compression failed
+    size_t          size;
+} snapshot_save_job_t;
+#endif
+
 typedef struct {
     int             part_num;
     bool            use_ega;
     game_lang_t     lang;
     bool            enable_protection;
+    bool            use_display_list;
+    bool            fix_up_palette;
+    bool            front_to_back;
+    bool            heatmap;
+    bool            packed_pages;
+    int             scale;
 } game_options_t;
 
 static struct {
@@ -48,9 +75,13 @@ static struct {
     game_options_t  options;
     game_t          game;
     uint32_t        frame_time_us;
+    FILE*           scene_file;     // receives the scene stream with the scene=<path> option
     #ifdef GAME_USE_UI
         ui_game_t   ui;
         game_snapshot_t snapshots[UI_SNAPSHOT_MAX_SLOTS];
+        uint8_t     snapshot_buf[GAME_SNAPSHOT_MAX_SIZE];   // uncompressed snapshot stream
+        snapshot_save_job_t* save_jobs[SNAPSHOT_SAVE_QUEUE_SIZE];  // save_jobs[0] runs on the worker
+        int         num_save_jobs;
     #endif
 } state = {0};
 
@@ -64,7 +95,39 @@ static void push_audio(const float* samples, int num_samples, void* user_data) {
     saudio_push(samples, num_samples/2);
 }
 
+// rasterizes the bands of a page on the thread pool
+static void raster_parallel_for(int num_bands, game_band_func_t func, void* band_data, void* user_data) {
+    (void)user_data;
+    pool_run(num_bands, func, band_data);
+}
+
+// the high resolution pages are rasterized by the thread pool started in app_init()
+static game_raster_desc_t game_raster_desc(void) {
+    if (state.options.scale <= 1) {
+        return (game_raster_desc_t){0};
+    }
+    return (game_raster_desc_t){ .func = raster_parallel_for, .num_bands = pool_num_threads() };
+}
+
+// appends the scene stream of each presented frame to the file, see tools/scene2svg
+static void write_scene(const uint8_t* data, size_t size, void* user_data) {
+    fwrite(data, 1, size, (FILE*)user_data);
+}
+
+static game_scene_desc_t game_scene_desc(void) {
+    if (!state.scene_file) {
+        return (game_scene_desc_t){0};
+    }
+    return (game_scene_desc_t){ .func = write_scene, .user_data = state.scene_file };
+}
+
 #if defined(GAME_USE_UI)
+// the rewind history keeps the high resolution pages too, it gets the room of more frames with them
+static game_rewind_desc_t game_rewind_desc(void) {
+    const uint32_t scale = (state.options.scale > 1) ? (uint32_t)state.options.scale : 1;
+    return (game_rewind_desc_t){ .max_bytes = REWIND_HISTORY_SIZE * scale };
+}
+
 static void ui_draw_cb(const ui_draw_info_t* draw_info) {
     ui_game_draw(&state.ui, &(ui_game_frame_t){
         .display = draw_info->display,
@@ -75,29 +138,133 @@ static void ui_save_settings_cb(ui_settings_t* settings) {
     ui_game_save_settings(&state.ui, settings);
 }
 
-static void ui_update_snapshot_screenshot(size_t slot) {
-    ui_snapshot_screenshot_t screenshot = {
-        .texture = ui_create_screenshot_texture(game_display_info(&state.snapshots[slot].game))
-    };
+static void ui_set_snapshot_screenshot(size_t slot, ui_snapshot_screenshot_t screenshot) {
     ui_snapshot_screenshot_t prev_screenshot = ui_snapshot_set_screenshot(&state.ui.snapshot, slot, screenshot);
     if (prev_screenshot.texture) {
         ui_destroy_texture(prev_screenshot.texture);
     }
 }
 
+static void ui_update_snapshot_screenshot(size_t slot, game_t* game) {
+    ui_set_snapshot_screenshot(slot, (ui_snapshot_screenshot_t){
+        .texture = ui_create_screenshot_texture(game_display_info(game))
+    });
+}
+
+// decompress a snapshot slot into state.snapshot_buf, returns the stream size or 0 on error
+static size_t ui_unpack_snapshot(const game_snapshot_t* snapshot) {
+    mz_ulong size = sizeof(state.snapshot_buf);
+    if (mz_uncompress(state.snapshot_buf, &size, snapshot->data, (mz_ulong)snapshot->size) != MZ_OK) {
+        return 0;
+    }
+    return (size_t)size;
+}
+
+static void ui_set_snapshot(size_t slot, uint8_t* data, size_t size) {
+    free(state.snapshots[slot].data);
+    state.snapshots[slot] = (game_snapshot_t){ .data = data, .size = size };
+}
+
 static bool ui_load_snapshot(size_t slot) {
     bool success = false;
-    if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.snapshot.slots[slot].valid)) {
-        success = game_load_snapshot(&state.game, state.snapshots[slot].version, &state.snapshots[slot].game);
+    if (state.ready && (slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.snapshot.slots[slot].valid)) {
+        const size_t size = ui_unpack_snapshot(&state.snapshots[slot]);
+        success = (size > 0) && game_load_snapshot(&state.game, state.snapshot_buf, size);
     }
     return success;
 }
 
+// runs on the worker thread, must not touch the game or the UI
+static void ui_save_snapshot_job(void* user_data) {
+    snapshot_save_job_t* job = (snapshot_save_job_t*)user_data;
+    mz_ulong size = mz_compressBound((mz_ulong)job->stream_size);
+    job->data = (uint8_t*)malloc(size);
+    if (mz_compress2(job->data, &size, job->stream, (mz_ulong)job->stream_size, MZ_BEST_SPEED) == MZ_OK) {
+        job->size = size;
+        #if !defined(__EMSCRIPTEN__)
+        fs_save_snapshot("raw", job->slot, (gfx_range_t){ .ptr = job->data, .size = job->size });
+        #endif
+    } else {
+        free(job->data);
+        job->data = 0;
+    }
+    free(job->stream);
+    job->stream = 0;
+}
+
+// called on the frame thread when the worker has finished a save
+static void ui_save_snapshot_done(void* user_data) {
+    snapshot_save_job_t* job = (snapshot_save_job_t*)user_data;
+    if (job->data) {
+        #if defined(__EMSCRIPTEN__)
+        // the snapshots go to IndexedDB, which only the main thread may call
+        fs_save_snapshot("raw", job->slot, (gfx_range_t){ .ptr = job->data, .size = job->size });
+        #endif
+        ui_set_snapshot(job->slot, job->data, job->size);
+        ui_set_snapshot_screenshot(job->slot, job->screenshot);
+    } else {
+        ui_destroy_texture(job->screenshot.texture);
+    }
+    free(job);
+    state.num_save_jobs--;
+    memmove(&state.save_jobs[0], &state.save_jobs[1], (size_t)state.num_save_jobs * sizeof(state.save_jobs[0]));
+    if (state.num_save_jobs > 0) {
+        worker_start(ui_save_snapshot_job, ui_save_snapshot_done, state.save_jobs[0]);
+    }
+}
+
 static void ui_save_snapshot(size_t slot) {
-    if (slot < UI_SNAPSHOT_MAX_SLOTS) {
-        state.snapshots[slot].version = game_save_snapshot(&state.game, &state.snapshots[slot].game);
-        ui_update_snapshot_screenshot(slot);
-        fs_save_snapshot("raw", slot, (gfx_range_t){ .ptr = &state.snapshots[slot], sizeof(gfx_range_t) });
+    if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.num_save_jobs < SNAPSHOT_SAVE_QUEUE_SIZE)) {
+        // only capture the state here, compression and file output happen on the worker
+        uint8_t* stream = (uint8_t*)malloc(GAME_SNAPSHOT_MAX_SIZE);
+        const size_t size = game_save_snapshot(&state.game, stream, GAME_SNAPSHOT_MAX_SIZE);
+        if (size == 0) {
+            free(stream);
+            return;
+        }
+        snapshot_save_job_t* job = (snapshot_save_job_t*)calloc(1, sizeof(snapshot_save_job_t));
+        job->slot = slot;
+        job->screenshot.texture = ui_create_screenshot_texture(game_display_info(&state.game));
+        job->stream = (uint8_t*)realloc(stream, size);
+        job->stream_size = size;
+        state.save_jobs[state.num_save_jobs++] = job;
+        if (state.num_save_jobs == 1) {
+            worker_start(ui_save_snapshot_job, ui_save_snapshot_done, job);
+        }
+    }
+}
+
+static void ui_rewind(int seconds) {
+    if (state.ready) {
+        game_rewind_time(&state.game, (uint32_t)seconds * 1000);
+    }
+}
+
+static void ui_fetch_snapshot_callback(const fs_snapshot_response_t* response) {
+    const size_t slot = response->snapshot_index;
+    if ((response->result != FS_RESULT_SUCCESS) || (slot >= UI_SNAPSHOT_MAX_SLOTS)) {
+        return;
+    }
+    game_snapshot_t snapshot = { .data = (uint8_t*)response->data.ptr, .size = response->data.size };
+    const size_t size = ui_unpack_snapshot(&snapshot);
+    if (size == 0) {
+        return;
+    }
+    // decode into a scratch game to validate the stream and to get the screenshot
+    static game_t scratch;
+    game_init(&scratch, &(game_desc_t){0});
+    if (game_load_snapshot(&scratch, state.snapshot_buf, size)) {
+        uint8_t* data = (uint8_t*)malloc(snapshot.size);
+        memcpy(data, snapshot.data, snapshot.size);
+        ui_set_snapshot(slot, data, snapshot.size);
+        ui_update_snapshot_screenshot(slot, &scratch);
+    }
+    game_cleanup(&scratch);
+}
+
+static void ui_load_snapshots_from_storage(void) {
+    for (size_t slot = 0; slot < UI_SNAPSHOT_MAX_SLOTS; slot++) {
+        fs_load_snapshot_async("raw", slot, ui_fetch_snapshot_callback);
     }
 }
 #endif
@@ -129,18 +296,40 @@ static void app_init(void) {
         .lang = lang,
         .use_ega = sargs_exists("use_ega"),
         .enable_protection = sargs_exists("protec"),
+        .use_display_list = sargs_exists("display_list"),
+        .fix_up_palette = sargs_exists("fix_up_palette"),
+        .front_to_back = sargs_exists("front_to_back"),
+        .heatmap = sargs_exists("heatmap"),
+        .packed_pages = sargs_exists("packed_pages"),
+        .scale = sargs_exists("scale") ? atoi(sargs_value("scale")) : 1,
     };
+    if (state.options.scale > 1) {
+        pool_init(0);
+    }
+    if (sargs_exists("scene")) {
+        state.scene_file = fopen(sargs_value("scene"), "wb");
+    }
 
     game_init(&state.game, &(game_desc_t){
         .part_num = state.options.part_num,
         .use_ega = state.options.use_ega,
         .enable_protection = state.options.enable_protection,
+        .use_display_list = state.options.use_display_list,
+        .fix_up_palette = state.options.fix_up_palette,
+        .front_to_back = state.options.front_to_back,
+        .heatmap = state.options.heatmap,
+        .packed_pages = state.options.packed_pages,
+        .bitmap_cache_bytes = BITMAP_CACHE_SIZE,
+        .scale = state.options.scale,
+        .raster = game_raster_desc(),
+        .scene = game_scene_desc(),
         .lang = state.options.lang,
         .audio = {
             .callback = { .func = push_audio },
         },
         #if defined(GAME_USE_UI)
-            .debug = ui_game_get_debug(&state.ui)
+            .debug = ui_game_get_debug(&state.ui),
+            .rewind = game_rewind_desc(),
         #endif
     });
     gfx_init(&(gfx_desc_t){
@@ -169,6 +358,7 @@ static void app_init(void) {
             .snapshot = {
                 .load_cb = ui_load_snapshot,
                 .save_cb = ui_save_snapshot,
+                .rewind_cb = ui_rewind,
                 .empty_slot_screenshot = {
                     .texture = ui_shared_empty_snapshot_texture(),
                 }
@@ -182,6 +372,8 @@ static void app_init(void) {
             }
         });
         ui_game_load_settings(&state.ui, ui_settings());
+        ui_load_snapshots_from_storage();
+        worker_init();
     #endif
 
     if (sargs_exists("file")) {
@@ -190,20 +382,31 @@ static void app_init(void) {
 }
 
 static void _game_start(void) {
+    game_cleanup(&state.game);
     game_init(&state.game, &(game_desc_t){
         .part_num = state.options.part_num,
         .use_ega = state.options.use_ega,
         .enable_protection = state.options.enable_protection,
+        .use_display_list = state.options.use_display_list,
+        .fix_up_palette = state.options.fix_up_palette,
+        .front_to_back = state.options.front_to_back,
+        .heatmap = state.options.heatmap,
+        .packed_pages = state.options.packed_pages,
+        .bitmap_cache_bytes = BITMAP_CACHE_SIZE,
+        .scale = state.options.scale,
+        .raster = game_raster_desc(),
+        .scene = game_scene_desc(),
         .lang = state.options.lang,
         .audio = {
             .callback = { .func = push_audio },
         },
-         #if defined(GAME_USE_UI)
-            .debug = ui_game_get_debug(&state.ui)
+        #if defined(GAME_USE_UI)
+            .debug = ui_game_get_debug(&state.ui),
+            .rewind = game_rewind_desc(),
         #endif
     });
     game_start(&state.game, state.data);
-    sapp_set_window_title(state.game.title);
+    sapp_set_window_title(state.game.host.title);
 }
 
 int _game_strnicmp(const char* a, const char* b, size_t i)
@@ -275,17 +478,35 @@ static void handle_file_loading(void) {
 static void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     gfx_draw(game_display_info(&state.game));
+    game_reset_dirty_rows(&state.game);
     if(state.ready) {
         game_exec(&state.game, state.frame_time_us/1000);
     }
     handle_file_loading();
+    #ifdef GAME_USE_UI
+        worker_dowork();
+    #endif
 }
 
 static void app_cleanup(void) {
     game_cleanup(&state.game);
+    if (state.scene_file) {
+        fclose(state.scene_file);
+    }
+    if (state.options.scale > 1) {
+        pool_shutdown();
+    }
     #ifdef GAME_USE_UI
+        // finish the pending snapshot saves
+        while (state.num_save_jobs > 0) {
+            worker_wait();
+        }
+        worker_shutdown();
         ui_game_discard(&state.ui);
         ui_discard();
+        for (size_t slot = 0; slot < UI_SNAPSHOT_MAX_SLOTS; slot++) {
+            ui_set_snapshot(slot, 0, 0);
+        }
     #endif
     saudio_shutdown();
     gfx_shutdown();
@@ -51,7 +51,9 @@ typedef struct {
     bool open;
     ui_dbg_texture_callbacks_t texture_cbs;
     ui_texture_t tex_fb[4];
+    ui_texture_t tex_heat[4];
     uint32_t pixel_buffer[GAME_WIDTH*GAME_HEIGHT];
+    uint8_t page_buffer[GAME_WIDTH*GAME_HEIGHT];
 } ui_game_video_t;
 
 
@@ -116,8 +118,6 @@ typedef struct {
     int             x, y;
     int             w, h;
     bool            open;
-    const float*    sample_buffer;  /* pointer to audio sample buffer */
-    int*            num_samples;    /* max number of samples in sample buffer */
 } ui_game_audio_t;
 
 typedef struct {
@@ -235,10 +235,21 @@ static void _ui_game_draw_menu(ui_game_t* ui) {
 
 static void _ui_game_update_fbs(ui_game_t* ui) {
     for(int i=0; i<4; i++) {
+        game_peek_page(ui->game, i, ui->video.page_buffer);
+        game_convert_pixels(ui->video.pixel_buffer, ui->video.page_buffer, GAME_WIDTH*GAME_HEIGHT, ui->game->gfx.palette, GAME_PIXEL_RGBA32);
+        ui->video.texture_cbs.update_cb(ui->video.tex_fb[i], ui->video.pixel_buffer, GAME_WIDTH*GAME_HEIGHT*sizeof(uint32_t));
+    }
+}
+
+static void _ui_game_update_heatmap(ui_game_t* ui) {
+    // black for no write, then blue, green, yellow, orange and red for 5 writes and more
+    static const uint32_t ramp[6] = { 0xFF000000, 0xFF800000, 0xFF00C000, 0xFF00FFFF, 0xFF0080FF, 0xFF0000FF };
+    for(int i=0; i<4; i++) {
+        const uint16_t* counts = game_heatmap_counts(ui->game, i);
         for(int j=0; j<GAME_WIDTH*GAME_HEIGHT; j++) {
-            ui->video.pixel_buffer[j] = ui->game->gfx.palette[ui->game->gfx.fbs[i].buffer[j]];
+            ui->video.pixel_buffer[j] = ramp[_MIN(counts[j], 5)];
         }
-        ui->video.texture_cbs.update_cb(ui->video.tex_fb[i], ui->video.pixel_buffer, GAME_WIDTH*GAME_HEIGHT*sizeof(uint32_t));
+        ui->video.texture_cbs.update_cb(ui->video.tex_heat[i], ui->video.pixel_buffer, GAME_WIDTH*GAME_HEIGHT*sizeof(uint32_t));
     }
 }
 
@@ -371,23 +382,10 @@ inline uint16_t _read_be_uint16(const void *ptr) {
 	return (b[0] << 8) | b[1];
 }
 
-static void decode_amiga(const uint8_t *src, uint32_t *dst, uint32_t pal[16]) {
-	static const int plane_size = GAME_WIDTH * GAME_HEIGHT / 8;
-	for (int y = 0; y < GAME_HEIGHT; ++y) {
-		for (int x = 0; x < GAME_WIDTH; x += 8) {
-			for (int b = 0; b < 8; ++b) {
-				const int mask = 1 << (7 - b);
-				uint8_t color = 0;
-				for (int p = 0; p < 4; ++p) {
-					if (src[p * plane_size] & mask) {
-						color |= 1 << p;
-					}
-				}
-				*dst++ = pal[color];
-			}
-			++src;
-		}
-	}
+static void decode_amiga(const game_t* game, const uint8_t *src, uint32_t *dst, uint32_t pal[16]) {
+	static uint8_t chunky[GAME_WIDTH * GAME_HEIGHT];
+	game_decode_bitmap(game, src, chunky);
+	game_convert_pixels(dst, chunky, GAME_WIDTH * GAME_HEIGHT, pal, GAME_PIXEL_RGBA32);
 }
 
 static void _ui_game_get_pal(ui_game_t* ui, int res_id, int id, uint32_t pal[16]) {
@@ -716,7 +714,7 @@ static void _ui_game_draw_sel_res(ui_game_t* ui) {
         _ui_game_get_pal_for_res(ui, ui->res.selected, pal);
         if(game_get_res_buf(ui->game, ui->res.selected, buffer)) {
             static const char* _res_ids[] = { "0x14", "0x17", "0x1a", "0x1d", "0x20", "0x23", "0x26", "0x29", "0x7d" };
-            decode_amiga(buffer, (uint32_t*)ui->res.data.bmp.buf, pal);
+            decode_amiga(ui->game, buffer, (uint32_t*)ui->res.data.bmp.buf, pal);
             ui->video.texture_cbs.update_cb(ui->res.tex_bmp, ui->res.data.bmp.buf, GAME_WIDTH*GAME_HEIGHT*sizeof(uint32_t));
             ImGui::Image(ui->res.tex_bmp, ImVec2(GAME_WIDTH, GAME_HEIGHT));
             ImGui::Checkbox("Palette overwrite", &ui->res.data.pal.ovw);
@@ -816,7 +814,7 @@ static void _ui_game_draw_resources(ui_game_t* ui) {
                 if(e->status == 0xFF) break;
 
                 if(ui->res.filters[e->type]) continue;
-                if(ui->game->res.data.banks[e->bank_num-1].size == 0) continue;
+                if(ui->game->host.data.banks[e->bank_num-1].size == 0) continue;
 
                 ImGui::TableNextRow(0, 20.f);
                 ImGui::TableNextColumn();
@@ -855,7 +853,8 @@ static void _ui_game_draw_audio(ui_game_t* ui) {
     ImGui::SetNextWindowSize(ImVec2((float)ui->audio.w, (float)ui->audio.h), ImGuiCond_FirstUseEver);
     if (ImGui::Begin("Audio", &ui->audio.open)) {
         const ImVec2 area = ImGui::GetContentRegionAvail();
-        ImGui::PlotLines("##samples", ui->audio.sample_buffer, *ui->audio.num_samples, 0, 0, -1.0f, +1.0f, area);
+        // the game buffers are reallocated on restart, always read them through the game
+        ImGui::PlotLines("##samples", ui->game->audio.sample_buffer, ui->game->audio.num_samples, 0, 0, -1.0f, +1.0f, area);
     }
     ImGui::End();
 }
@@ -883,6 +882,10 @@ static void _ui_game_draw_video(ui_game_t* ui) {
         }
         if (ImGui::CollapsingHeader("Frame buffers", ImGuiTreeNodeFlags_DefaultOpen)) {
             ImGui::Text("Current page: %d", ui->game->video.buffers[0]);
+            if (ui->game->host.front_to_back) {
+                const game_gfx_overdraw_t* od = &ui->game->host.overdraw;
+                ImGui::Text("Overdraw saved: %.2fx", od->written ? (double)od->drawn / (double)od->written : 1.0);
+            }
             _ui_game_update_fbs(ui);
             for(int i=0; i<4; i++) {
                 const ImVec4 border_color = ui->game->video.buffers[0] == i ? ImGui::ColorConvertU32ToFloat4(0xFF30FF30) : ImVec4(0, 0, 0, 1);
@@ -892,6 +895,21 @@ static void _ui_game_draw_video(ui_game_t* ui) {
                 }
             }
         }
+        if (ui->game->host.heatmap && ImGui::CollapsingHeader("Heatmap")) {
+            static const char* names[GAME_GFX_WRITE_NUM] = { "Solid", "Alpha", "Page", "Copy", "Clear", "Glyph", "Bitmap" };
+            const game_gfx_heat_stats_t stats = game_heatmap_stats(ui->game);
+            ImGui::Text("Overdraw: %.2fx of %u pixels", (double)stats.overdraw, stats.pixels);
+            for(int i=0; i<GAME_GFX_WRITE_NUM; i++) {
+                ImGui::Text("%-7s %llu", names[i], (unsigned long long)stats.writes[i]);
+            }
+            _ui_game_update_heatmap(ui);
+            for(int i=0; i<4; i++) {
+                ImGui::Image(ui->video.tex_heat[i], ImVec2(GAME_WIDTH, GAME_HEIGHT));
+                if (i != 1) {
+                    ImGui::SameLine();
+                }
+            }
+        }
     }
     ImGui::End();
 }
@@ -900,11 +918,11 @@ static uint8_t _ui_raw_mem_read(int layer, uint16_t addr, bool* valid, void* use
     GAME_ASSERT(user_data);
     (void)layer;
     ui_game_t* ui = (ui_game_t*) user_data;
-    uint8_t* pc = ui->game->res.seg_code;
+    const game_t* game = ui->game;
     *valid = false;
-    if (pc != NULL && addr >= 0 && addr < ui->game->res.seg_code_size) {
+    if (game->res.mem != NULL && addr < game->res.seg_code_size) {
         *valid = true;
-        return pc[addr];
+        return game->res.mem[game->res.seg_code + addr];
     }
     return 0;
 }
@@ -919,11 +937,11 @@ static uint8_t _ui_raw_dasm_read(int layer, uint16_t addr, bool* valid, void* us
     GAME_ASSERT(user_data);
     (void)layer;
     ui_game_t* ui = (ui_game_t*) user_data;
-    uint8_t* pc = ui->game->res.seg_code;
+    const game_t* game = ui->game;
     *valid = false;
-    if (pc != NULL && addr >= 0 && addr < ui->game->res.seg_code_size) {
+    if (game->res.mem != NULL && addr < game->res.seg_code_size) {
         *valid = true;
-        return pc[addr];
+        return game->res.mem[game->res.seg_code + addr];
     }
     return 0;
 }
@@ -977,6 +995,7 @@ void ui_game_init(ui_game_t* ui, const ui_game_desc_t* ui_desc) {
         ui->video.h = 568;
         for(int i=0; i<4; i++) {
             ui->video.tex_fb[i] = ui->video.texture_cbs.create_cb(GAME_WIDTH, GAME_HEIGHT);
+            ui->video.tex_heat[i] = ui->video.texture_cbs.create_cb(GAME_WIDTH, GAME_HEIGHT);
         }
     }
     {
@@ -1005,8 +1024,6 @@ void ui_game_init(ui_game_t* ui, const ui_game_desc_t* ui_desc) {
     }
     ui->res.tex_bmp = ui->video.texture_cbs.create_cb(GAME_WIDTH, GAME_HEIGHT);
     ui->res.tex_fb = ui->video.texture_cbs.create_cb(GAME_WIDTH, GAME_HEIGHT);
-    ui->audio.sample_buffer = ui->game->audio.sample_buffer;
-    ui->audio.num_samples = &ui->game->audio.num_samples;
 }
 
 void ui_game_discard(ui_game_t* ui) {
@@ -1015,6 +1032,7 @@ void ui_game_discard(ui_game_t* ui) {
     ui->video.texture_cbs.destroy_cb(ui->res.tex_fb);
     for(int i=0; i<4; i++) {
         ui->video.texture_cbs.destroy_cb(ui->video.tex_fb[i]);
+        ui->video.texture_cbs.destroy_cb(ui->video.tex_heat[i]);
     }
     for (int i = 0; i < 4; i++) {
         ui_dasm_discard(&ui->dasm[i]);
@@ -57,6 +57,8 @@ typedef uint64_t ui_snapshot_texture_t;
 typedef void (*ui_snapshot_save_t)(size_t slot_index);
 // callback function to load snapshot from numbered slot
 typedef bool (*ui_snapshot_load_t)(size_t slot_index);
+// optional callback function to step back in time by a number of seconds
+typedef void (*ui_snapshot_rewind_t)(int seconds);
 
 // a snapshot screenshot wrapper struct
 typedef struct {
@@ -74,6 +76,7 @@ typedef struct {
 typedef struct {
     ui_snapshot_save_t save_cb;
     ui_snapshot_load_t load_cb;
+    ui_snapshot_rewind_t rewind_cb;
     ui_snapshot_screenshot_t empty_slot_screenshot;
 } ui_snapshot_desc_t;
 
@@ -81,6 +84,7 @@ typedef struct {
 typedef struct {
     ui_snapshot_save_t save_cb;
     ui_snapshot_load_t load_cb;
+    ui_snapshot_rewind_t rewind_cb;
     ui_snapshot_slot_t slots[UI_SNAPSHOT_MAX_SLOTS];
 } ui_snapshot_t;
 
@@ -113,6 +117,7 @@ void ui_snapshot_init(ui_snapshot_t* state, const ui_snapshot_desc_t* desc) {
     memset(state, 0, sizeof(ui_snapshot_t));
     state->save_cb = desc->save_cb;
     state->load_cb = desc->load_cb;
+    state->rewind_cb = desc->rewind_cb;
     for (size_t i = 0; i < UI_SNAPSHOT_MAX_SLOTS; i++) {
         state->slots[i].screenshot = desc->empty_slot_screenshot;
     }
@@ -177,6 +182,17 @@ void ui_snapshot_menus(ui_snapshot_t* state) {
         }
         ImGui::EndMenu();
     }
+    if (state->rewind_cb && ImGui::BeginMenu("Rewind")) {
+        static const int seconds[] = { 1, 5, 10, 30, 60 };
+        for (int i = 0; i < (int)(sizeof(seconds) / sizeof(seconds[0])); i++) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "%d second%s", seconds[i], (seconds[i] > 1) ? "s" : "");
+            if (ImGui::MenuItem(buf)) {
+                state->rewind_cb(seconds[i]);
+            }
+        }
+        ImGui::EndMenu();
+    }
 }
 
 void ui_snapshot_save_slot(ui_snapshot_t* state, size_t slot_index) {
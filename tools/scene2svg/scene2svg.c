@@ -0,0 +1,630 @@
+/*
+    Converts a scene stream (see game_desc_t.scene in src/game.h) to one SVG
+    file per presented frame.
+
+    The pages are replayed as SVG elements. A copy freezes the content of the
+    source page into a node, a group in the <defs> of the frames, which both
+    pages then refer to with <use>, so nothing is duplicated. The elements
+    are drawn with the palette indices instead of colors, bits 0-2 in red and
+    bit 3 in blue, so the alpha blend (pixels OR'ed with 8) is an exact
+    'lighten' blend of pure blue and the page blend is page 0 clipped by the
+    shape. A filter on the presented page turns the indices into the colors
+    of the palette of the frame. The RGB backgrounds are written once per
+    resource as <prefix>bgN.png and shown below the page they follow, the
+    filter then making color 0 transparent.
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+// must match GAME_SCENE_VERSION, game_scene_op_t and game_scene_blend_t in src/game.h
+#define SCENE_VERSION       (2)
+#define SCENE_WIDTH         (320)
+#define SCENE_HEIGHT        (200)
+#define SCENE_NUM_PAGES     (4)
+
+typedef enum {
+    SCENE_OP_BEGIN,
+    SCENE_OP_FILL,
+    SCENE_OP_COPY,
+    SCENE_OP_POLYGON,
+    SCENE_OP_POINT,
+    SCENE_OP_CHAR,
+    SCENE_OP_BITMAP,
+    SCENE_OP_FRAME,
+    SCENE_OP_BACKGROUND,
+} scene_op_t;
+
+typedef enum {
+    SCENE_BLEND_SOLID,
+    SCENE_BLEND_ALPHA,
+    SCENE_BLEND_PAGE,
+} scene_blend_t;
+
+typedef struct {
+    char*   buf;
+    size_t  len, cap;
+} svg_text_t;
+
+// SVG elements and the nodes they refer to
+typedef struct {
+    svg_text_t  text;
+    int*        refs;
+    int         num_refs, cap_refs;
+} svg_content_t;
+
+typedef struct {
+    svg_content_t   content;
+    bool            used;
+    bool            marked;
+} svg_node_t;
+
+static struct {
+    svg_content_t   pages[SCENE_NUM_PAGES];
+    int             page_nodes[SCENE_NUM_PAGES];    // node with the whole content of each page, -1 if none
+    svg_node_t*     nodes;
+    int             num_nodes;
+    int*            stack;                          // nodes left to mark, see _svg_mark_nodes()
+    uint32_t        clip_id;
+    int             bg_res[SCENE_NUM_PAGES];        // background resource of each page, -1 if none
+    int             bg_dy[SCENE_NUM_PAGES];
+    bool            bg_written[0x10000];            // resources already written as images
+} state;
+
+static void* _svg_realloc(void* ptr, size_t size) {
+    ptr = realloc(ptr, size);
+    if (!ptr) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    return ptr;
+}
+
+static void _svg_text_append(svg_text_t* t, const char* s, size_t len) {
+    if (t->len + len + 1 > t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 4096;
+        while (cap < t->len + len + 1) {
+            cap *= 2;
+        }
+        t->buf = (char*)_svg_realloc(t->buf, cap);
+        t->cap = cap;
+    }
+    memcpy(t->buf + t->len, s, len);
+    t->len += len;
+    t->buf[t->len] = 0;
+}
+
+static void _svg_text_printf(svg_text_t* t, const char* fmt, ...) {
+    char tmp[256];
+    va_list args;
+    va_start(args, fmt);
+    const int len = vsnprintf(tmp, sizeof(tmp), fmt, args);
+    va_end(args);
+    _svg_text_append(t, tmp, (size_t)len);
+}
+
+static void _svg_content_clear(svg_content_t* c) {
+    c->text.len = 0;
+    c->num_refs = 0;
+}
+
+static void _svg_content_use(svg_content_t* c, int node) {
+    if (c->num_refs == c->cap_refs) {
+        c->cap_refs = c->cap_refs ? c->cap_refs * 2 : 16;
+        c->refs = (int*)_svg_realloc(c->refs, c->cap_refs * sizeof(int));
+    }
+    c->refs[c->num_refs++] = node;
+    _svg_text_printf(&c->text, "<use href=\"#g%d\"/>", node);
+}
+
+static uint16_t _svg_read_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static int16_t _svg_read_i16(const uint8_t* p) {
+    return (int16_t)_svg_read_u16(p);
+}
+
+static uint32_t _svg_read_u32(const uint8_t* p) {
+    return _svg_read_u16(p) | ((uint32_t)_svg_read_u16(p + 2) << 16);
+}
+
+static void _svg_put_u32be(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t _svg_crc32(uint32_t crc, const uint8_t* p, size_t len) {
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ p[i]) & 255] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void _svg_write_chunk(FILE* fp, const char* type, const uint8_t* data, size_t len) {
+    uint8_t tmp[4];
+    _svg_put_u32be(tmp, (uint32_t)len);
+    fwrite(tmp, 1, 4, fp);
+    fwrite(type, 1, 4, fp);
+    if (len) {
+        fwrite(data, 1, len, fp);
+    }
+    _svg_put_u32be(tmp, _svg_crc32(_svg_crc32(0, (const uint8_t*)type, 4), data, len));
+    fwrite(tmp, 1, 4, fp);
+}
+
+// w x h pixels 0xAABBGGRR as an RGB PNG, the rows are stored without compression
+static bool _svg_write_png(const char* path, const uint8_t* pixels, int w, int h) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "Unable to open '%s' for writing\n", path);
+        return false;
+    }
+    const size_t raw_size = (size_t)h * (1 + 3 * (size_t)w);
+    uint8_t* raw = (uint8_t*)_svg_realloc(0, raw_size);
+    uint8_t* q = raw;
+    for (int y = 0; y < h; y++) {
+        *q++ = 0;
+        for (int x = 0; x < w; x++) {
+            const uint8_t* p = pixels + 4 * ((size_t)y * w + x);
+            *q++ = p[0];
+            *q++ = p[1];
+            *q++ = p[2];
+        }
+    }
+    // zlib stream of stored blocks of up to 65535 bytes
+    const size_t num_blocks = raw_size ? (raw_size + 65534) / 65535 : 1;
+    uint8_t* z = (uint8_t*)_svg_realloc(0, 2 + 5 * num_blocks + raw_size + 4);
+    size_t len = 0;
+    z[len++] = 0x78;
+    z[len++] = 0x01;
+    uint32_t a = 1, b = 0;
+    for (size_t pos = 0, i = 0; i < num_blocks; i++) {
+        const size_t n = (raw_size - pos < 65535) ? raw_size - pos : 65535;
+        z[len++] = (i == num_blocks - 1) ? 1 : 0;
+        z[len++] = (uint8_t)n;
+        z[len++] = (uint8_t)(n >> 8);
+        z[len++] = (uint8_t)~n;
+        z[len++] = (uint8_t)(~n >> 8);
+        memcpy(z + len, raw + pos, n);
+        len += n;
+        for (size_t k = 0; k < n; k++) {
+            a = (a + raw[pos + k]) % 65521;
+            b = (b + a) % 65521;
+        }
+        pos += n;
+    }
+    _svg_put_u32be(z + len, (b << 16) | a);
+    len += 4;
+    uint8_t ihdr[13] = { 0 };
+    _svg_put_u32be(ihdr, (uint32_t)w);
+    _svg_put_u32be(ihdr + 4, (uint32_t)h);
+    ihdr[8] = 8;    // bits per channel
+    ihdr[9] = 2;    // RGB
+    fwrite("\x89PNG\r\n\x1a\n", 1, 8, fp);
+    _svg_write_chunk(fp, "IHDR", ihdr, sizeof(ihdr));
+    _svg_write_chunk(fp, "IDAT", z, len);
+    _svg_write_chunk(fp, "IEND", 0, 0);
+    free(z);
+    free(raw);
+    const bool ok = !ferror(fp);
+    fclose(fp);
+    if (!ok) {
+        fprintf(stderr, "Unable to write '%s'\n", path);
+    }
+    return ok;
+}
+
+// the palette index as a color, see the 'palette' filter
+static const char* _svg_index_color(int color) {
+    static char tmp[8];
+    snprintf(tmp, sizeof(tmp), "#%02x00%02x", (color & 7) * 17, (color & 8) ? 255 : 0);
+    return tmp;
+}
+
+static int _svg_alloc_node(void) {
+    for (int i = 0; i < state.num_nodes; i++) {
+        if (!state.nodes[i].used) {
+            state.nodes[i].used = true;
+            return i;
+        }
+    }
+    const int count = state.num_nodes ? state.num_nodes * 2 : 64;
+    state.nodes = (svg_node_t*)_svg_realloc(state.nodes, count * sizeof(svg_node_t));
+    memset(state.nodes + state.num_nodes, 0, (count - state.num_nodes) * sizeof(svg_node_t));
+    state.stack = (int*)_svg_realloc(state.stack, count * sizeof(int));
+    const int node = state.num_nodes;
+    state.num_nodes = count;
+    state.nodes[node].used = true;
+    return node;
+}
+
+// the content of the page moves into a node, the page then only refers to it
+static int _svg_freeze_page(int page) {
+    if (state.page_nodes[page] < 0) {
+        const int node = _svg_alloc_node();
+        const svg_content_t c = state.nodes[node].content;
+        state.nodes[node].content = state.pages[page];
+        state.pages[page] = c;
+        _svg_content_clear(&state.pages[page]);
+        _svg_content_use(&state.pages[page], node);
+        state.page_nodes[page] = node;
+    }
+    return state.page_nodes[page];
+}
+
+static svg_content_t* _svg_edit_page(int page) {
+    state.page_nodes[page] = -1;
+    return &state.pages[page];
+}
+
+static void _svg_mark_nodes(const svg_content_t* c) {
+    int top = 0;
+    for (int i = 0; i < c->num_refs; i++) {
+        if (!state.nodes[c->refs[i]].marked) {
+            state.nodes[c->refs[i]].marked = true;
+            state.stack[top++] = c->refs[i];
+        }
+    }
+    while (top > 0) {
+        const svg_content_t* n = &state.nodes[state.stack[--top]].content;
+        for (int i = 0; i < n->num_refs; i++) {
+            if (!state.nodes[n->refs[i]].marked) {
+                state.nodes[n->refs[i]].marked = true;
+                state.stack[top++] = n->refs[i];
+            }
+        }
+    }
+}
+
+static void _svg_clear_marks(void) {
+    for (int i = 0; i < state.num_nodes; i++) {
+        state.nodes[i].marked = false;
+    }
+}
+
+// free the nodes none of the pages refers to anymore
+static void _svg_collect_nodes(void) {
+    _svg_clear_marks();
+    for (int i = 0; i < SCENE_NUM_PAGES; i++) {
+        _svg_mark_nodes(&state.pages[i]);
+    }
+    for (int i = 0; i < state.num_nodes; i++) {
+        if (state.nodes[i].used && !state.nodes[i].marked) {
+            state.nodes[i].used = false;
+            _svg_content_clear(&state.nodes[i].content);
+        }
+    }
+}
+
+static void _svg_draw_shape(int page, int blend, int color, const char* shape) {
+    switch (blend) {
+    case SCENE_BLEND_SOLID:
+        _svg_text_printf(&_svg_edit_page(page)->text, "<g fill=\"%s\">", _svg_index_color(color));
+        _svg_text_append(&state.pages[page].text, shape, strlen(shape));
+        _svg_text_append(&state.pages[page].text, "</g>", 4);
+        break;
+    case SCENE_BLEND_ALPHA:
+        // sets bit 3 of the index, bits 0-2 are kept by the max of each channel
+        _svg_text_printf(&_svg_edit_page(page)->text, "<g fill=\"#0000ff\" style=\"mix-blend-mode:lighten\">");
+        _svg_text_append(&state.pages[page].text, shape, strlen(shape));
+        _svg_text_append(&state.pages[page].text, "</g>", 4);
+        break;
+    case SCENE_BLEND_PAGE:
+        if (page != 0) {
+            const int node = _svg_freeze_page(0);
+            const uint32_t id = state.clip_id++;
+            svg_content_t* c = _svg_edit_page(page);
+            _svg_text_printf(&c->text, "<clipPath id=\"k%u\">", id);
+            _svg_text_append(&c->text, shape, strlen(shape));
+            _svg_text_printf(&c->text, "</clipPath><g clip-path=\"url(#k%u)\">", id);
+            _svg_content_use(c, node);
+            _svg_text_append(&c->text, "</g>", 4);
+        }
+        break;
+    }
+}
+
+static void _svg_draw_polygon(int page, int blend, int color, const uint8_t* p, int n) {
+    static char shape[64 + 24 * 256];
+    int len = snprintf(shape, sizeof(shape), "<polygon points=\"");
+    for (int i = 0; i < n; i++) {
+        // the spans include the pixel of the right edge, which is the first half of the outline
+        const int x = _svg_read_i16(p + 4 * i) + ((i < n / 2) ? 1 : 0);
+        const int y = _svg_read_i16(p + 4 * i + 2);
+        len += snprintf(shape + len, sizeof(shape) - len, "%s%d,%d", i ? " " : "", x, y);
+    }
+    snprintf(shape + len, sizeof(shape) - len, "\"/>");
+    _svg_draw_shape(page, blend, color, shape);
+}
+
+static void _svg_draw_point(int page, int blend, int color, int x, int y) {
+    char shape[64];
+    snprintf(shape, sizeof(shape), "<rect x=\"%d\" y=\"%d\" width=\"1\" height=\"1\"/>", x, y);
+    _svg_draw_shape(page, blend, color, shape);
+}
+
+static void _svg_draw_char(int page, int color, int x, int y, const uint8_t* rows) {
+    if ((rows[0] | rows[1] | rows[2] | rows[3] | rows[4] | rows[5] | rows[6] | rows[7]) == 0) {
+        return;
+    }
+    svg_text_t* t = &_svg_edit_page(page)->text;
+    _svg_text_printf(t, "<path fill=\"%s\" d=\"", _svg_index_color(color));
+    for (int j = 0; j < 8; j++) {
+        for (int i = 0; i < 8; ) {
+            if (rows[j] & (0x80 >> i)) {
+                int w = 1;
+                while ((i + w < 8) && (rows[j] & (0x80 >> (i + w)))) {
+                    w++;
+                }
+                _svg_text_printf(t, "M%d %dh%dv1h-%dz", x + i, y + j, w, w);
+                i += w;
+            } else {
+                i++;
+            }
+        }
+    }
+    _svg_text_append(t, "\"/>", 3);
+}
+
+// one path per color with the horizontal runs of pixels
+static void _svg_draw_bitmap(int page, const uint8_t* p) {
+    svg_content_t* c = _svg_edit_page(page);
+    _svg_content_clear(c);
+    for (int color = 0; color < 16; color++) {
+        bool found = false;
+        for (int y = 0; y < SCENE_HEIGHT; y++) {
+            const uint8_t* row = p + y * SCENE_WIDTH / 2;
+            for (int x = 0; x < SCENE_WIDTH; ) {
+                int w = 0;
+                while ((x + w < SCENE_WIDTH) && (((row[(x + w) / 2] >> (((x + w) & 1) ? 0 : 4)) & 15) == color)) {
+                    w++;
+                }
+                if (w == 0) {
+                    x++;
+                    continue;
+                }
+                if (!found) {
+                    _svg_text_printf(&c->text, "<path fill=\"%s\" d=\"", _svg_index_color(color));
+                    found = true;
+                }
+                _svg_text_printf(&c->text, "M%d %dh%dv1h-%dz", x, y, w, w);
+                x += w;
+            }
+        }
+        if (found) {
+            _svg_text_append(&c->text, "\"/>", 3);
+        }
+    }
+}
+
+static void _svg_write_text(FILE* fp, const svg_text_t* t) {
+    if (t->len) {
+        fwrite(t->buf, 1, t->len, fp);
+    }
+}
+
+static void _svg_write_table(FILE* fp, const char* func, const uint8_t* palette, int shift) {
+    fprintf(fp, "<%s type=\"discrete\" tableValues=\"", func);
+    for (int i = 0; i < 16; i++) {
+        fprintf(fp, "%s%.4f", i ? " " : "", ((_svg_read_u32(palette + 4 * i) >> shift) & 255) / 255.);
+    }
+    fprintf(fp, "\"/>\n");
+}
+
+static const char* _svg_basename(const char* path) {
+    const char* s = strrchr(path, '/');
+    return s ? s + 1 : path;
+}
+
+static bool _svg_write_frame(const char* prefix, uint32_t frame, int page, const uint8_t* palette) {
+    const bool bg = state.bg_res[page] >= 0;
+    char path[1024];
+    snprintf(path, sizeof(path), "%s%06u.svg", prefix, frame);
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "Unable to open '%s' for writing\n", path);
+        return false;
+    }
+    fprintf(fp, "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 %d %d\" width=\"%d\" height=\"%d\" shape-rendering=\"crispEdges\">\n<defs>\n", SCENE_WIDTH, SCENE_HEIGHT, SCENE_WIDTH, SCENE_HEIGHT);
+    // index = 15 * red + 8 * blue, then one table per channel, over a background the index is also the alpha
+    fprintf(fp, "<filter id=\"palette\" filterUnits=\"userSpaceOnUse\" x=\"0\" y=\"0\" width=\"%d\" height=\"%d\" color-interpolation-filters=\"sRGB\">\n", SCENE_WIDTH, SCENE_HEIGHT);
+    fprintf(fp, "<feColorMatrix type=\"matrix\" values=\"1 0 0.5333 0 0 1 0 0.5333 0 0 1 0 0.5333 0 0 %s\"/>\n", bg ? "1 0 0.5333 0 0" : "0 0 0 1 0");
+    fprintf(fp, "<feComponentTransfer>\n");
+    _svg_write_table(fp, "feFuncR", palette, 0);
+    _svg_write_table(fp, "feFuncG", palette, 8);
+    _svg_write_table(fp, "feFuncB", palette, 16);
+    if (bg) {
+        // color 0 shows the background
+        fprintf(fp, "<feFuncA type=\"discrete\" tableValues=\"0 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1\"/>\n");
+    }
+    fprintf(fp, "</feComponentTransfer>\n</filter>\n");
+    _svg_clear_marks();
+    _svg_mark_nodes(&state.pages[page]);
+    for (int i = 0; i < state.num_nodes; i++) {
+        if (state.nodes[i].marked) {
+            fprintf(fp, "<g id=\"g%d\" style=\"isolation:isolate\">", i);
+            _svg_write_text(fp, &state.nodes[i].content.text);
+            fprintf(fp, "</g>\n");
+        }
+    }
+    fprintf(fp, "</defs>\n");
+    if (bg) {
+        // black where the image is scrolled out of the page
+        fprintf(fp, "<rect width=\"%d\" height=\"%d\" fill=\"#000000\"/>\n", SCENE_WIDTH, SCENE_HEIGHT);
+        fprintf(fp, "<image href=\"%sbg%d.png\" y=\"%d\" width=\"%d\" height=\"%d\" preserveAspectRatio=\"none\" style=\"image-rendering:pixelated\"/>\n",
+            _svg_basename(prefix), state.bg_res[page], state.bg_dy[page], SCENE_WIDTH, SCENE_HEIGHT);
+    }
+    fprintf(fp, "<g filter=\"url(#palette)\" style=\"isolation:isolate\">");
+    _svg_write_text(fp, &state.pages[page].text);
+    fprintf(fp, "</g>\n</svg>\n");
+    fclose(fp);
+    return true;
+}
+
+static uint8_t* _svg_read_file(const char* path, size_t* size) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "Unable to open '%s'\n", path);
+        return 0;
+    }
+    fseek(fp, 0, SEEK_END);
+    *size = (size_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uint8_t* data = (uint8_t*)malloc(*size ? *size : 1);
+    if (data && (fread(data, 1, *size, fp) != *size)) {
+        free(data);
+        data = 0;
+    }
+    fclose(fp);
+    return data;
+}
+
+// returns the number of frames written, -1 on invalid data or when a file can't be written
+static int _svg_convert(const uint8_t* data, size_t size, const char* prefix) {
+    for (int i = 0; i < SCENE_NUM_PAGES; i++) {
+        state.page_nodes[i] = -1;
+        state.bg_res[i] = -1;
+    }
+    int count = 0;
+    uint32_t frame = 0;
+    size_t pos = 0;
+    while (pos < size) {
+        const uint8_t op = data[pos++];
+        const uint8_t* p = data + pos;
+        const size_t left = size - pos;
+        size_t len = 0;
+        switch (op) {
+        case SCENE_OP_BEGIN:    len = 6; break;
+        case SCENE_OP_FILL:     len = 2; break;
+        case SCENE_OP_COPY:     len = 4; break;
+        case SCENE_OP_POLYGON:  len = (left >= 4) ? 4 + 4 * p[3] : 4; break;
+        case SCENE_OP_POINT:    len = 7; break;
+        case SCENE_OP_CHAR:     len = 14; break;
+        case SCENE_OP_BITMAP:   len = 1 + SCENE_WIDTH * SCENE_HEIGHT / 2; break;
+        case SCENE_OP_FRAME:    len = 1 + 16 * 4; break;
+        case SCENE_OP_BACKGROUND: len = (left >= 9) ? 9 + 4 * (size_t)_svg_read_u16(p + 5) * _svg_read_u16(p + 7) : 9; break;
+        default:
+            fprintf(stderr, "Invalid record %d at offset %zu\n", op, pos - 1);
+            return -1;
+        }
+        if (left < len) {
+            fprintf(stderr, "Truncated record %d at offset %zu\n", op, pos - 1);
+            return -1;
+        }
+        if (((op != SCENE_OP_BEGIN) && (p[0] >= SCENE_NUM_PAGES)) || ((op == SCENE_OP_COPY) && (p[1] >= SCENE_NUM_PAGES))) {
+            fprintf(stderr, "Invalid page at offset %zu\n", pos - 1);
+            return -1;
+        }
+        switch (op) {
+        case SCENE_OP_BEGIN:
+            if (_svg_read_u16(p) != SCENE_VERSION) {
+                fprintf(stderr, "Unsupported scene version %d\n", _svg_read_u16(p));
+                return -1;
+            }
+            frame = _svg_read_u32(p + 2);
+            break;
+        case SCENE_OP_FILL: {
+            svg_content_t* c = _svg_edit_page(p[0]);
+            _svg_content_clear(c);
+            state.bg_res[p[0]] = -1;
+            _svg_text_printf(&c->text, "<rect width=\"%d\" height=\"%d\" fill=\"%s\"/>", SCENE_WIDTH, SCENE_HEIGHT, _svg_index_color(p[1]));
+            break;
+        }
+        case SCENE_OP_COPY: {
+            const int dst = p[0];
+            const int vscroll = _svg_read_i16(p + 2);
+            const int node = _svg_freeze_page(p[1]);
+            state.bg_res[dst] = state.bg_res[p[1]];
+            state.bg_dy[dst] = state.bg_dy[p[1]] + vscroll;
+            if (vscroll == 0) {
+                if (dst != p[1]) {
+                    _svg_content_clear(&state.pages[dst]);
+                    _svg_content_use(&state.pages[dst], node);
+                    state.page_nodes[dst] = node;
+                }
+            } else {
+                // the rows of the source scrolled out of the page are hidden by the nested viewport
+                svg_content_t* c = _svg_edit_page(dst);
+                _svg_text_printf(&c->text, "<svg y=\"%d\" width=\"%d\" height=\"%d\">", vscroll, SCENE_WIDTH, SCENE_HEIGHT);
+                _svg_content_use(c, node);
+                _svg_text_append(&c->text, "</svg>", 6);
+            }
+            break;
+        }
+        case SCENE_OP_POLYGON:
+            _svg_draw_polygon(p[0], p[1], p[2], p + 4, p[3]);
+            break;
+        case SCENE_OP_POINT:
+            _svg_draw_point(p[0], p[1], p[2], _svg_read_i16(p + 3), _svg_read_i16(p + 5));
+            break;
+        case SCENE_OP_CHAR:
+            _svg_draw_char(p[0], p[1], _svg_read_i16(p + 2), _svg_read_i16(p + 4), p + 6);
+            break;
+        case SCENE_OP_BITMAP:
+            _svg_draw_bitmap(p[0], p + 1);
+            state.bg_res[p[0]] = -1;
+            break;
+        case SCENE_OP_BACKGROUND: {
+            const int res_num = _svg_read_u16(p + 1);
+            if (!state.bg_written[res_num]) {
+                char path[1024];
+                snprintf(path, sizeof(path), "%sbg%d.png", prefix, res_num);
+                if (!_svg_write_png(path, p + 9, _svg_read_u16(p + 5), _svg_read_u16(p + 7))) {
+                    return -1;
+                }
+                state.bg_written[res_num] = true;
+            }
+            state.bg_res[p[0]] = res_num;
+            state.bg_dy[p[0]] = _svg_read_i16(p + 3);
+            break;
+        }
+        case SCENE_OP_FRAME:
+            if (!_svg_write_frame(prefix, frame, p[0], p + 1)) {
+                return -1;
+            }
+            _svg_collect_nodes();
+            count++;
+            break;
+        }
+        pos += len;
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    if ((argc != 2) && (argc != 3)) {
+        fprintf(stdout, "Usage: %s scene.bin [prefix]\n", argv[0]);
+        fprintf(stdout, "  writes <prefix>NNNNNN.svg for each frame of the scene stream, prefix defaults to 'frame',\n");
+        fprintf(stdout, "  and <prefix>bgN.png for the RGB background of resource N\n");
+        return 0;
+    }
+    size_t size = 0;
+    uint8_t* data = _svg_read_file(argv[1], &size);
+    if (!data) {
+        return 1;
+    }
+    const int count = _svg_convert(data, size, (argc == 3) ? argv[2] : "frame");
+    free(data);
+    if (count < 0) {
+        return 1;
+    }
+    fprintf(stdout, "%d frames written\n", count);
+    return 0;
+}